@@ -0,0 +1,111 @@
+#!/usr/bin/python
+
+"""
+  Turns the binary log written by the sketch (see sketch_jun06a/Log.h) back
+  into text. The message formats are read from sketch_jun06a/LogMessages.h.
+
+  Usage:
+    format-log.py logfile            (use - to read from stdin)
+    format-log.py --port /dev/ttyACM0 [--baud 9600]   (needs pyserial)
+"""
+
+import os
+import re
+import struct
+import sys
+
+SYNC_BYTE = 0xA5
+HEADER_LENGTH = 3
+
+MESSAGES_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "sketch_jun06a", "LogMessages.h")
+
+# Sizes of the AVR types behind the conversions
+ARGUMENT_FORMATS = {
+  "d": "<h", "u": "<H",
+  "ld": "<l", "lu": "<L",
+  "c": "<c",
+}
+
+CONVERSION = re.compile(r"%(l?[duc]|s|%)")
+
+def loadMessages(filename):
+  messages = []
+  with open(filename) as f:
+    for line in f:
+      m = re.search(r'LOG_MESSAGE\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', line)
+      if m and m.group(1) != "id":
+        messages.append((m.group(1), m.group(2)))
+  return messages
+
+def formatRecord(messages, messageId, payload):
+  if messageId >= len(messages):
+    return "<unknown message %d: %s>" % (messageId, " ".join("%02x" % b for b in bytearray(payload)))
+  
+  name, fmt = messages[messageId]
+  args = []
+  offset = 0
+  for conversion in CONVERSION.findall(fmt):
+    if conversion == "%":
+      continue
+    if conversion == "s":
+      length = bytearray(payload[offset:offset + 1])
+      if not length:
+        break
+      args.append(payload[offset + 1:offset + 1 + length[0]].decode("latin-1"))
+      offset += 1 + length[0]
+    else:
+      argFormat = ARGUMENT_FORMATS[conversion]
+      size = struct.calcsize(argFormat)
+      if offset + size > len(payload):
+        break
+      value = struct.unpack(argFormat, payload[offset:offset + size])[0]
+      args.append(value.decode("latin-1") if conversion == "c" else value)
+      offset += size
+  
+  # All conversions become %s, the values are already decoded
+  pythonFormat = CONVERSION.sub(lambda m: "%%" if m.group(1) == "%" else "%s", fmt)
+  try:
+    return pythonFormat % tuple(args)
+  except TypeError:
+    return "<truncated %s: %s>" % (name, ", ".join(map(str, args)))
+
+def readRecords(stream):
+  """Yields (id, payload) tuples, resynchronizing on garbage in the stream"""
+  data = bytearray()
+  while True:
+    chunk = stream.read(1)
+    if not chunk:
+      return
+    data += bytearray(chunk)
+    
+    while data:
+      if data[0] != SYNC_BYTE:
+        del data[0]
+        continue
+      if len(data) < HEADER_LENGTH:
+        break
+      length = data[2]
+      if len(data) < HEADER_LENGTH + length:
+        break
+      yield data[1], bytes(data[HEADER_LENGTH:HEADER_LENGTH + length])
+      del data[:HEADER_LENGTH + length]
+
+def openInput(args):
+  if "--port" in args:
+    import serial
+    port = args[args.index("--port") + 1]
+    baud = int(args[args.index("--baud") + 1]) if "--baud" in args else 9600
+    return serial.Serial(port, baud)
+  if args[0] == "-":
+    return getattr(sys.stdin, "buffer", sys.stdin)
+  return open(args[0], "rb")
+
+if len(sys.argv) < 2:
+  print("1 argument required: binary-log-file (or --port serial-port)")
+  sys.exit(1)
+
+messages = loadMessages(MESSAGES_FILE)
+stream = openInput(sys.argv[1:])
+for messageId, payload in readRecords(stream):
+  print(formatRecord(messages, messageId, payload))
+  sys.stdout.flush()
@@ -0,0 +1,48 @@
+#!/usr/bin/python
+
+"""
+  Converts an image of any size (at least 128x64) into the tiled poster
+  format shown by the poster viewer (see sketch_jun06a/TiledImage.h).
+  Put the results into the /posters directory of the SD card.
+"""
+
+import sys
+import struct
+
+import numpy as np
+import scipy.ndimage as ndi
+
+TILE_WIDTH = 16
+FORMAT_VERSION = 1
+
+if len(sys.argv) < 3:
+  print("2 arguments required: source-image target-filename")
+  sys.exit(1)
+
+img = ndi.imread(sys.argv[1], flatten=True) # Loads images as 2 dimensional, grayscale image
+
+# Make a binary image out of the grayscale image  
+img = img < 128 # Note that black pixels must be set to become black on the LCD!
+
+# Pad to full tiles and pages at the right and bottom of the image
+height = (img.shape[0] + 7) // 8 * 8
+width = (img.shape[1] + TILE_WIDTH - 1) // TILE_WIDTH * TILE_WIDTH
+if width > 0xFFFF or height // 8 > 0xFF:
+  raise ValueError("Image is too large")
+padded = np.zeros((height, width), dtype=bool)
+padded[:img.shape[0], :img.shape[1]] = img
+img = padded
+
+# Display was mounted upside down, rotate images by 180 degreees
+img = np.fliplr(np.flipud(img))
+
+# Column bytes of all pages: bit i of a byte is pixel row i of the page
+pages = img.reshape(height // 8, 8, width)
+weights = (1 << np.arange(8)).reshape(1, 8, 1)
+columnBytes = (pages * weights).sum(axis=1).astype(np.uint8)
+
+with open(sys.argv[2], "wb") as f:
+  f.write(struct.pack("<ccBBHBB", b"P", b"T", FORMAT_VERSION, TILE_WIDTH, width, height // 8, 0))
+  
+  # Page by page, tile by tile - a page row of tiles is simply the page
+  f.write(columnBytes.tobytes())
@@ -0,0 +1,141 @@
+#!/usr/bin/python
+
+"""
+  Converts text files (e.g. sentences/*.txt) into pre-shaped text files
+  for the slide show (see SlideShow::showText in the sketch). Lines are
+  word-wrapped to the real display width using the glyph widths of the
+  font in sketch_jun06a/ReversedCharset.cpp, and every character is
+  replaced by its position and its columns in the charset data, so the
+  Arduino only has to copy glyph columns. Characters missing from the
+  font are reported here, the conversion fails if there are any.
+
+  Output files are named TEXT0000.STX, TEXT0001.STX, ... in the order of
+  the source files (the SD library only supports 8.3 names). Put them
+  into the /texts directory of the SD card.
+
+  File layout:
+    'S', 'T', version, number of lines
+    per line: number of glyphs, per glyph (ReversedCharset::ShapedGlyph):
+      first column in the rotated display row, number of columns,
+      offset in CHARSET_DATA (uint16, little endian)
+  Spaces take no record, they only move the following glyphs.
+"""
+
+import os
+import re
+import struct
+import sys
+
+FORMAT_VERSION = 2         # ReversedCharset::SHAPED_TEXT_VERSION
+SPACE_GLYPH = -1           # marks spaces while shaping
+SPACE_WIDTH = 3            # as in ReversedCharset::displayString
+LINE_WIDTH = 128 - 1       # ReversedCharset never writes the first column
+LINE_COUNT = 8
+
+CHARSET_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "sketch_jun06a", "ReversedCharset.cpp")
+
+def loadArray(source, name):
+  m = re.search(name + r"\[\]\s*PROGMEM\s*=\s*\{([^}]*)\}", source)
+  if not m:
+    raise ValueError("Cannot find " + name + " in " + CHARSET_FILE)
+  return [int(x, 0) for x in m.group(1).split(",")]
+
+with open(CHARSET_FILE) as f:
+  charsetSource = f.read()
+offsets = loadArray(charsetSource, "CHARACTER_OFFSETS")
+lookup = loadArray(charsetSource, "CHAR_LOOKUP_TABLE")
+
+def glyphWidth(glyph):
+  if glyph == SPACE_GLYPH:
+    return SPACE_WIDTH
+  return offsets[glyph + 1] - offsets[glyph] + 1 # glyph columns + one empty column
+
+def shapeLine(text, sourceName, lineNumber, errors):
+  """Returns a list of lines, each a list of glyphs"""
+  words = []
+  for word in text.split(" "):
+    glyphs = []
+    for c in word:
+      glyph = lookup[ord(c)] if ord(c) < len(lookup) else -1
+      if glyph < 0:
+        errors.append("%s:%d: character %r (code %d) is not in the charset" % (sourceName, lineNumber, c, ord(c)))
+      else:
+        glyphs.append(glyph)
+    words.append(glyphs)
+  
+  # Every word but the first is preceded by a space, so leading and repeated
+  # spaces are kept. Only the space a line is wrapped at is dropped.
+  lines = [[]]
+  width = 0
+  for index, glyphs in enumerate(words):
+    wordWidth = sum(glyphWidth(g) for g in glyphs)
+    spaceWidth = SPACE_WIDTH if index > 0 else 0
+    
+    if lines[-1] and width + spaceWidth + wordWidth > LINE_WIDTH:
+      lines.append([])
+      width = 0
+      spaceWidth = 0
+    
+    if spaceWidth:
+      lines[-1].append(SPACE_GLYPH)
+      width += SPACE_WIDTH
+    
+    # Words longer than a line are broken anywhere
+    for g in glyphs:
+      if width + glyphWidth(g) > LINE_WIDTH:
+        lines.append([])
+        width = 0
+      lines[-1].append(g)
+      width += glyphWidth(g)
+  return lines
+
+def glyphRecords(line):
+  """Lays out a line as ReversedCharset::displayString does, right to left
+  in display memory (the display is mounted upside down)"""
+  records = []
+  x = LINE_WIDTH
+  for g in line:
+    x -= glyphWidth(g)
+    if g != SPACE_GLYPH:
+      records.append(struct.pack("<BBH", x, offsets[g + 1] - offsets[g], offsets[g]))
+  assert x >= 0 and len(records) < 256
+  return records
+
+def shapeText(text, sourceName, errors):
+  lines = []
+  for lineNumber, line in enumerate(text.replace("\r", "").replace("\t", " ").split("\n")):
+    lines.extend(shapeLine(line.rstrip(" "), sourceName, lineNumber + 1, errors))
+  
+  while lines and not lines[-1]:
+    lines.pop()
+  if len(lines) > LINE_COUNT:
+    print("Warning: %s needs %d lines, only the first %d are shown" % (sourceName, len(lines), LINE_COUNT))
+    lines = lines[:LINE_COUNT]
+  return lines
+
+if len(sys.argv) < 3:
+  print("at least 2 arguments required: target-directory source-text [source-text ...]")
+  sys.exit(1)
+
+targetDirectory = sys.argv[1]
+errors = []
+for index, sourceName in enumerate(sys.argv[2:]):
+  with open(sourceName, "rb") as f:
+    text = f.read().decode("latin-1")
+  errorCount = len(errors)
+  lines = shapeText(text, sourceName, errors)
+  if len(errors) > errorCount:
+    continue
+  
+  targetName = os.path.join(targetDirectory, "TEXT%04d.STX" % index)
+  with open(targetName, "wb") as f:
+    f.write(struct.pack("<ccBB", b"S", b"T", FORMAT_VERSION, len(lines)))
+    for line in lines:
+      records = glyphRecords(line)
+      f.write(struct.pack("B", len(records)))
+      f.write(b"".join(records))
+  print("%s -> %s" % (sourceName, targetName))
+
+if errors:
+  print("\n".join(errors))
+  sys.exit(1)
@@ -0,0 +1,265 @@
+
+#include "PageFormat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+unsigned int Bitmap :: bytesPerRow() const {
+  return (width + 7) / 8;
+}
+
+Bitmap :: Bitmap() : width(0), height(0) {
+}
+
+Bitmap :: Bitmap(unsigned int width, unsigned int height) : width(width), height(height), data(bytesPerRow() * height, 0) {
+}
+
+// The transpose is done in three steps, each swapping bit blocks across the
+// diagonal: 1x1 blocks within 2x2 blocks, 2x2 within 4x4, 4x4 within 8x8
+// (Hacker's Delight, 7-3).
+static const uint64_t TRANSPOSE_MASK_1 = 0x00AA00AA00AA00AAULL;
+static const uint64_t TRANSPOSE_MASK_2 = 0x0000CCCC0000CCCCULL;
+static const uint64_t TRANSPOSE_MASK_4 = 0x00000000F0F0F0F0ULL;
+
+uint64_t transpose8x8(uint64_t m) {
+  uint64_t t;
+  t = (m ^ (m >> 7)) & TRANSPOSE_MASK_1;
+  m ^= t ^ (t << 7);
+  t = (m ^ (m >> 14)) & TRANSPOSE_MASK_2;
+  m ^= t ^ (t << 14);
+  t = (m ^ (m >> 28)) & TRANSPOSE_MASK_4;
+  m ^= t ^ (t << 28);
+  return m;
+}
+
+#if defined(__AVX2__)
+
+static inline __m256i deltaSwap(__m256i m, int shift, uint64_t mask) {
+  const __m256i t = _mm256_and_si256(_mm256_xor_si256(m, _mm256_srli_epi64(m, shift)), _mm256_set1_epi64x(mask));
+  return _mm256_xor_si256(m, _mm256_xor_si256(t, _mm256_slli_epi64(t, shift)));
+}
+
+void transpose8x8(uint64_t* m, size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m + i));
+    v = deltaSwap(v, 7, TRANSPOSE_MASK_1);
+    v = deltaSwap(v, 14, TRANSPOSE_MASK_2);
+    v = deltaSwap(v, 28, TRANSPOSE_MASK_4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(m + i), v);
+  }
+  for (; i < count; i++) {
+    m[i] = transpose8x8(m[i]);
+  }
+}
+
+const char* transposeImplementation() {
+  return "AVX2";
+}
+
+#elif defined(__SSE2__)
+
+static inline __m128i deltaSwap(__m128i m, int shift, uint64_t mask) {
+  const __m128i t = _mm_and_si128(_mm_xor_si128(m, _mm_srli_epi64(m, shift)), _mm_set1_epi64x(mask));
+  return _mm_xor_si128(m, _mm_xor_si128(t, _mm_slli_epi64(t, shift)));
+}
+
+void transpose8x8(uint64_t* m, size_t count) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m + i));
+    v = deltaSwap(v, 7, TRANSPOSE_MASK_1);
+    v = deltaSwap(v, 14, TRANSPOSE_MASK_2);
+    v = deltaSwap(v, 28, TRANSPOSE_MASK_4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(m + i), v);
+  }
+  for (; i < count; i++) {
+    m[i] = transpose8x8(m[i]);
+  }
+}
+
+const char* transposeImplementation() {
+  return "SSE2";
+}
+
+#else
+
+void transpose8x8(uint64_t* m, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    m[i] = transpose8x8(m[i]);
+  }
+}
+
+const char* transposeImplementation() {
+  return "scalar";
+}
+
+#endif
+
+// How a block of 8x8 pixels maps to an uint64: 
+//   bitmap -> byte r holds pixel row r, pixel c of the row is bit 7 - c
+//   page   -> byte c holds pixel column c, pixel row r is bit r
+// Reversing the byte order of the bitmap block turns the pixel at (r, c) 
+// into bit 8 * (7 - r) + (7 - c); the transpose moves it to 8 * (7 - c) + (7 - r),
+// which is exactly the page block rotated by 180 degrees. Without rotation, 
+// the transpose of the unreversed block yields the columns in reverse order.
+
+std::vector<uint8_t> toPageFormat(const Bitmap& bitmap, bool rotate) {
+  const unsigned int blocksPerPage = bitmap.bytesPerRow();
+  const unsigned int pages = (bitmap.height + 7) / 8;
+  const unsigned int width = blocksPerPage * 8;
+  
+  std::vector<uint8_t> result(width * pages);
+  std::vector<uint64_t> blocks(blocksPerPage);
+  
+  for (unsigned int page = 0; page < pages; page++) {
+    for (unsigned int bx = 0; bx < blocksPerPage; bx++) {
+      uint64_t block = 0;
+      for (unsigned int r = 0; r < 8; r++) {
+        const unsigned int y = page * 8 + r;
+        if (y < bitmap.height) {
+          const uint64_t b = bitmap.data[y * blocksPerPage + bx];
+          block |= b << (8 * (rotate ? 7 - r : r));
+        }
+      }
+      blocks[bx] = block;
+    }
+    
+    transpose8x8(blocks.data(), blocksPerPage);
+    
+    for (unsigned int bx = 0; bx < blocksPerPage; bx++) {
+      const uint64_t block = blocks[bx];
+      if (rotate) {
+        uint8_t* out = &result[(pages - 1 - page) * width + (blocksPerPage - 1 - bx) * 8];
+        for (int c = 0; c < 8; c++) {
+          out[c] = static_cast<uint8_t>(block >> (8 * c));
+        }
+      } else {
+        uint8_t* out = &result[page * width + bx * 8];
+        for (int c = 0; c < 8; c++) {
+          out[c] = static_cast<uint8_t>(block >> (8 * (7 - c)));
+        }
+      }
+    }
+  }
+  return result;
+}
+
+Bitmap fromPageFormat(const uint8_t* data, unsigned int width, unsigned int pages, bool rotate) {
+  Bitmap bitmap(width, pages * 8);
+  const unsigned int blocksPerPage = width / 8;
+  std::vector<uint64_t> blocks(blocksPerPage);
+  
+  // Same mapping as toPageFormat, run backwards - the transpose is its own inverse
+  for (unsigned int page = 0; page < pages; page++) {
+    for (unsigned int bx = 0; bx < blocksPerPage; bx++) {
+      uint64_t block = 0;
+      for (int c = 0; c < 8; c++) {
+        uint64_t b;
+        if (rotate) {
+          b = data[(pages - 1 - page) * width + (blocksPerPage - 1 - bx) * 8 + c];
+          block |= b << (8 * c);
+        } else {
+          b = data[page * width + bx * 8 + c];
+          block |= b << (8 * (7 - c));
+        }
+      }
+      blocks[bx] = block;
+    }
+    
+    transpose8x8(blocks.data(), blocksPerPage);
+    
+    for (unsigned int bx = 0; bx < blocksPerPage; bx++) {
+      for (unsigned int r = 0; r < 8; r++) {
+        bitmap.data[(page * 8 + r) * blocksPerPage + bx] = static_cast<uint8_t>(blocks[bx] >> (8 * (rotate ? 7 - r : r)));
+      }
+    }
+  }
+  return bitmap;
+}
+
+// Reads the next header field of a netpbm file, skipping comments
+static bool readHeaderValue(std::istream& in, unsigned int& value) {
+  while (in) {
+    const int c = in.peek();
+    if (c == '#') {
+      std::string comment;
+      std::getline(in, comment);
+    } else if (isspace(c)) {
+      in.get();
+    } else {
+      break;
+    }
+  }
+  return static_cast<bool>(in >> value);
+}
+
+bool readNetpbm(const std::string& filename, uint8_t threshold, Bitmap& bitmap, std::string& error) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  if (!in) {
+    error = "cannot open " + filename;
+    return false;
+  }
+  
+  char magic[2];
+  unsigned int width, height, maxValue = 1;
+  if (!in.read(magic, 2) || (magic[0] != 'P') || ((magic[1] != '4') && (magic[1] != '5'))) {
+    error = filename + " is not a binary PBM or PGM file";
+    return false;
+  }
+  const bool gray = magic[1] == '5';
+  
+  if (!readHeaderValue(in, width) || !readHeaderValue(in, height) || (gray && !readHeaderValue(in, maxValue))) {
+    error = "invalid header in " + filename;
+    return false;
+  }
+  if (gray && ((maxValue == 0) || (maxValue > 255))) {
+    error = filename + ": only 8 bit gray images are supported";
+    return false;
+  }
+  in.get(); // Single whitespace after the header
+  
+  bitmap = Bitmap(width, height);
+  if (!gray) {
+    if (!in.read(reinterpret_cast<char*>(bitmap.data.data()), bitmap.data.size())) {
+      error = "unexpected end of " + filename;
+      return false;
+    }
+    return true;
+  }
+  
+  std::vector<uint8_t> row(width);
+  for (unsigned int y = 0; y < height; y++) {
+    if (!in.read(reinterpret_cast<char*>(row.data()), width)) {
+      error = "unexpected end of " + filename;
+      return false;
+    }
+    uint8_t* out = &bitmap.data[y * bitmap.bytesPerRow()];
+    for (unsigned int x = 0; x < width; x++) {
+      // Scale to 0..255 for images with fewer gray levels
+      if (row[x] * 255u / maxValue < threshold) {
+        out[x / 8] |= 0x80 >> (x % 8);
+      }
+    }
+  }
+  return true;
+}
+
+bool writePbm(const std::string& filename, const Bitmap& bitmap, std::string& error) {
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  out << "P4\n" << bitmap.width << " " << bitmap.height << "\n";
+  out.write(reinterpret_cast<const char*>(bitmap.data.data()), bitmap.data.size());
+  if (!out) {
+    error = "cannot write " + filename;
+    return false;
+  }
+  return true;
+}
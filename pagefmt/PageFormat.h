@@ -0,0 +1,53 @@
+
+#ifndef PAGEFORMAT_H_
+#define PAGEFORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+// Conversion between row-major bitmaps and the page format of the display
+// (see LCDDisplay::writeImage): the image is cut into pages of 8 pixel rows,
+// each page is stored as one byte per pixel column, bit i being row i of the
+// page. Images are stored rotated by 180 degrees, as the display is mounted 
+// upside down.
+
+// 1 bit per pixel, rows are padded to full bytes, the leftmost pixel of a 
+// byte is its highest bit, 1 = black (the layout of binary PBM files).
+struct Bitmap {
+  unsigned int width, height;
+  std::vector<uint8_t> data;
+  
+  unsigned int bytesPerRow() const;
+  
+  Bitmap();
+  Bitmap(unsigned int width, unsigned int height);
+};
+
+// Transposes an 8x8 bit matrix: bit 8 * r + c becomes bit 8 * c + r
+uint64_t transpose8x8(uint64_t m);
+
+// Transposes count matrices in place, using SIMD instructions if available
+void transpose8x8(uint64_t* m, size_t count);
+
+// Name of the transpose implementation transpose8x8(m, count) uses
+const char* transposeImplementation();
+
+// Converts the bitmap into page format. Width and height are padded to
+// multiples of 8. If rotate is set, the image is rotated by 180 degrees in
+// the same pass (the format expected by the sketch).
+std::vector<uint8_t> toPageFormat(const Bitmap& bitmap, bool rotate);
+
+// Inverse of toPageFormat, width must be a multiple of 8
+Bitmap fromPageFormat(const uint8_t* data, unsigned int width, unsigned int pages, bool rotate);
+
+// Reads a binary PBM (P4) or 8 bit PGM (P5) file. Gray values below 
+// threshold become black. Returns false and sets error on failure.
+bool readNetpbm(const std::string& filename, uint8_t threshold, Bitmap& bitmap, std::string& error);
+
+// Writes a binary PBM (P4) file
+bool writePbm(const std::string& filename, const Bitmap& bitmap, std::string& error);
+
+#endif // PAGEFORMAT_H_
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Throughput of pagefmt compared to format-img.py.
+#
+# Runs the kernel benchmark, then converts the same set of 128x64 images
+# with both tools. The images are generated, so no image converter is needed;
+# the script part needs python 2.7 with numpy and scipy (see readme.txt).
+
+set -e
+cd "$(dirname "$0")"
+
+COUNT=${COUNT:-200}
+PYTHON=${PYTHON:-python}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+./pagefmt bench
+
+mkdir "$WORK/pgm" "$WORK/native" "$WORK/script"
+i=0
+while [ $i -lt $COUNT ]; do
+  # Random 128x64 gray image
+  { printf 'P5\n128 64\n255\n'; head -c 8192 /dev/urandom; } > "$WORK/pgm/img_$i.pgm"
+  i=$((i + 1))
+done
+
+echo
+echo "Converting $COUNT images with pagefmt batch:"
+./pagefmt batch "$WORK/pgm" "$WORK/native"
+
+if ! $PYTHON -c "import numpy, scipy.ndimage" 2>/dev/null; then
+  echo "Skipping format-img.py: $PYTHON with numpy and scipy not found"
+  exit 0
+fi
+
+echo "Converting $COUNT images with format-img.py:"
+START=$(date +%s.%N)
+for f in "$WORK"/pgm/*.pgm; do
+  $PYTHON ../format-img.py "$f" "$WORK/script/$(basename "$f" .pgm).img"
+done
+END=$(date +%s.%N)
+echo "Converted $COUNT files in $(echo "$END - $START" | bc) s"
+
+# Both tools must produce the same files
+for f in "$WORK"/native/*.img; do
+  cmp -s "$f" "$WORK/script/$(basename "$f")" || { echo "Output differs for $(basename "$f")"; exit 1; }
+done
+echo "Outputs are identical"
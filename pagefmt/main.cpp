@@ -0,0 +1,259 @@
+
+// Command line front end of the page format library, see usage()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PageFormat.h"
+
+namespace fs = std::filesystem;
+
+static const unsigned int DISPLAY_WIDTH = 128;
+
+static void usage() {
+  fprintf(stderr,
+    "Usage:\n"
+    "  pagefmt convert [options] source.pbm|pgm target.img\n"
+    "  pagefmt batch [options] [-j threads] source-directory target-directory\n"
+    "  pagefmt unpack [options] [-w width] source.img target.pbm\n"
+    "  pagefmt bench [-n images]\n"
+    "\n"
+    "Options:\n"
+    "  --no-rotate    do not rotate by 180 degrees (the display is mounted upside down)\n"
+    "  -t threshold   gray values below the threshold become black (default 128)\n"
+    "\n"
+    "batch converts all .pbm/.pgm files of the source directory into .img files.\n"
+    "Convert other formats first, e.g. with: convert image.png image.pgm\n");
+}
+
+struct Options {
+  bool rotate;
+  uint8_t threshold;
+  unsigned int threads;
+  unsigned int width;
+  unsigned int images;
+  std::vector<std::string> arguments;
+  
+  Options() : rotate(true), threshold(128), threads(std::thread::hardware_concurrency()), width(DISPLAY_WIDTH), images(20000) {}
+};
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 2; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--no-rotate") {
+      options.rotate = false;
+    } else if ((arg == "-t") && hasValue) {
+      options.threshold = atoi(argv[++i]);
+    } else if ((arg == "-j") && hasValue) {
+      options.threads = atoi(argv[++i]);
+    } else if ((arg == "-w") && hasValue) {
+      options.width = atoi(argv[++i]);
+    } else if ((arg == "-n") && hasValue) {
+      options.images = atoi(argv[++i]);
+    } else if (arg[0] == '-') {
+      return false;
+    } else {
+      options.arguments.push_back(arg);
+    }
+  }
+  if (options.threads == 0) {
+    options.threads = 1;
+  }
+  return true;
+}
+
+static bool convertFile(const std::string& source, const std::string& target, const Options& options, std::string& error) {
+  Bitmap bitmap;
+  if (!readNetpbm(source, options.threshold, bitmap, error)) {
+    return false;
+  }
+  
+  const std::vector<uint8_t> pages = toPageFormat(bitmap, options.rotate);
+  std::ofstream out(target.c_str(), std::ios::binary);
+  out.write(reinterpret_cast<const char*>(pages.data()), pages.size());
+  if (!out) {
+    error = "cannot write " + target;
+    return false;
+  }
+  return true;
+}
+
+static int convertCommand(const Options& options) {
+  if (options.arguments.size() != 2) {
+    usage();
+    return 1;
+  }
+  
+  std::string error;
+  if (!convertFile(options.arguments[0], options.arguments[1], options, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+static int batchCommand(const Options& options) {
+  if (options.arguments.size() != 2) {
+    usage();
+    return 1;
+  }
+  
+  std::vector<fs::path> sources;
+  std::error_code ec;
+  for (fs::directory_iterator it(options.arguments[0], ec), end; !ec && (it != end); it.increment(ec)) {
+    const std::string extension = it->path().extension().string();
+    if (it->is_regular_file() && ((extension == ".pbm") || (extension == ".pgm"))) {
+      sources.push_back(it->path());
+    }
+  }
+  if (ec) {
+    fprintf(stderr, "cannot read %s: %s\n", options.arguments[0].c_str(), ec.message().c_str());
+    return 1;
+  }
+  
+  const fs::path targetDirectory = options.arguments[1];
+  fs::create_directories(targetDirectory, ec);
+  
+  // Workers take the next file until all are done
+  std::atomic<size_t> next(0);
+  std::atomic<unsigned int> failures(0);
+  std::vector<std::thread> workers;
+  
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned int t = 0; t < options.threads; t++) {
+    workers.push_back(std::thread([&]() {
+      for (size_t i = next++; i < sources.size(); i = next++) {
+        const fs::path target = targetDirectory / sources[i].filename().replace_extension(".img");
+        std::string error;
+        if (!convertFile(sources[i].string(), target.string(), options, error)) {
+          fprintf(stderr, "%s\n", error.c_str());
+          failures++;
+        }
+      }
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  printf("Converted %u of %u files in %.3f s using %u threads\n", 
+    static_cast<unsigned int>(sources.size() - failures), static_cast<unsigned int>(sources.size()), seconds, options.threads);
+  return failures > 0 ? 1 : 0;
+}
+
+static int unpackCommand(const Options& options) {
+  if ((options.arguments.size() != 2) || (options.width == 0) || (options.width % 8 != 0)) {
+    usage();
+    return 1;
+  }
+  
+  std::ifstream in(options.arguments[0].c_str(), std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (data.empty() || (data.size() % options.width != 0)) {
+    fprintf(stderr, "%s is not a page format image of width %u\n", options.arguments[0].c_str(), options.width);
+    return 1;
+  }
+  
+  const Bitmap bitmap = fromPageFormat(data.data(), options.width, data.size() / options.width, options.rotate);
+  std::string error;
+  if (!writePbm(options.arguments[1], bitmap, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+// Straight port of the per-pixel loops of format-img.py, used as reference
+static std::vector<uint8_t> toPageFormatPerPixel(const Bitmap& bitmap, bool rotate) {
+  const unsigned int pages = bitmap.height / 8;
+  std::vector<uint8_t> result(pages * bitmap.width);
+  for (unsigned int page = 0; page < pages; page++) {
+    for (unsigned int x = 0; x < bitmap.width; x++) {
+      uint8_t b = 0;
+      for (unsigned int i = 0; i < 8; i++) {
+        const unsigned int sx = rotate ? bitmap.width - 1 - x : x;
+        const unsigned int sy = rotate ? bitmap.height - 1 - (page * 8 + i) : page * 8 + i;
+        const bool black = (bitmap.data[sy * bitmap.bytesPerRow() + sx / 8] >> (7 - sx % 8)) & 1;
+        b |= black << i;
+      }
+      result[page * bitmap.width + x] = b;
+    }
+  }
+  return result;
+}
+
+static int benchCommand(const Options& options) {
+  std::mt19937 random(42);
+  Bitmap bitmap(DISPLAY_WIDTH, 64);
+  for (size_t i = 0; i < bitmap.data.size(); i++) {
+    bitmap.data[i] = static_cast<uint8_t>(random());
+  }
+  
+  for (int rotate = 0; rotate < 2; rotate++) {
+    const std::vector<uint8_t> pages = toPageFormat(bitmap, rotate);
+    if (pages != toPageFormatPerPixel(bitmap, rotate)) {
+      fprintf(stderr, "Kernel result differs from the per-pixel reference%s!\n", rotate ? "" : " (--no-rotate)");
+      return 1;
+    }
+    if (fromPageFormat(pages.data(), bitmap.width, bitmap.height / 8, rotate).data != bitmap.data) {
+      fprintf(stderr, "Unpacking does not restore the image%s!\n", rotate ? "" : " (--no-rotate)");
+      return 1;
+    }
+  }
+  
+  const double megabytes = options.images * bitmap.data.size() / 1e6;
+  size_t checksum = 0;
+  
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < options.images; i++) {
+    bitmap.data[0] = static_cast<uint8_t>(i);
+    checksum += toPageFormat(bitmap, true)[i % bitmap.data.size()];
+  }
+  const double kernelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < options.images; i++) {
+    bitmap.data[0] = static_cast<uint8_t>(i);
+    checksum += toPageFormatPerPixel(bitmap, true)[i % bitmap.data.size()];
+  }
+  const double perPixelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  printf("%u images of 128x64 (checksum %u)\n", options.images, static_cast<unsigned int>(checksum & 0xFFFF));
+  printf("  transpose kernel (%s): %8.1f images/s, %7.1f MB/s\n", transposeImplementation(), options.images / kernelSeconds, megabytes / kernelSeconds);
+  printf("  per-pixel loops:         %8.1f images/s, %7.1f MB/s\n", options.images / perPixelSeconds, megabytes / perPixelSeconds);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if ((argc < 2) || !parseOptions(argc, argv, options)) {
+    usage();
+    return 1;
+  }
+  
+  const std::string command = argv[1];
+  if (command == "convert") {
+    return convertCommand(options);
+  } else if (command == "batch") {
+    return batchCommand(options);
+  } else if (command == "unpack") {
+    return unpackCommand(options);
+  } else if (command == "bench") {
+    return benchCommand(options);
+  }
+  
+  usage();
+  return 1;
+}
@@ -0,0 +1,302 @@
+
+#include "AssetIndex.h"
+
+#include "Log.h"
+
+static const char IMAGES_DIRECTORY[] PROGMEM = "/images";
+static const char TEXTS_DIRECTORY[] PROGMEM = "/texts";
+static const char MUSIC_DIRECTORY[] PROGMEM = "/music";
+static const char POSTERS_DIRECTORY[] PROGMEM = "/posters";
+
+const char* const AssetIndex::DIRECTORY_NAMES[AssetIndex::DIRECTORY_COUNT] PROGMEM = {
+  IMAGES_DIRECTORY, TEXTS_DIRECTORY, MUSIC_DIRECTORY, POSTERS_DIRECTORY
+};
+
+const char AssetIndex::INDEX_FILENAME[] PROGMEM = "/ASSETS.IDX";
+
+uint16_t* AssetIndex :: directoryEntries(uint8_t dir) {
+  uint16_t* result = entries;
+  for (int i = 0; i < dir; i++) {
+    result += counts[i];
+  }
+  return result;
+}
+
+unsigned int AssetIndex :: totalCount() const {
+  unsigned int result = 0;
+  for (int dir = 0; dir < DIRECTORY_COUNT; dir++) {
+    result += counts[dir];
+  }
+  return result;
+}
+
+File AssetIndex :: openDirectory(uint8_t dir) {
+  char name[MAX_PATH_LENGTH];
+  strncpy_P(name, reinterpret_cast<const char*>(pgm_read_word(DIRECTORY_NAMES + dir)), MAX_PATH_LENGTH - 1);
+  name[MAX_PATH_LENGTH - 1] = '\0';
+  return SD.open(name);
+}
+
+uint16_t AssetIndex :: directoryChecksum(uint8_t dir) {
+  File d = openDirectory(dir);
+  if (!d) {
+    return 0;
+  }
+  
+  uint8_t sum1 = 0, sum2 = 0;
+  uint8_t entry[DIR_ENTRY_SIZE];
+  while (d.read(entry, DIR_ENTRY_SIZE) == DIR_ENTRY_SIZE) {
+    if (entry[0] == 0) {
+      break; // End of directory, the remaining entries were never used
+    }
+    for (int i = 0; i < DIR_ENTRY_SIZE; i++) {
+      sum1 = (sum1 + entry[i]) % 255;
+      sum2 = (sum2 + sum1) % 255;
+    }
+  }
+  d.close();
+  
+  // Never 0, so that an empty directory differs from a missing one
+  return (static_cast<uint16_t>(sum2) << 8 | sum1) + 1;
+}
+
+File AssetIndex :: openFileAt(File& dir, uint16_t& entry) {
+  if (!dir.seek(static_cast<uint32_t>(entry) * DIR_ENTRY_SIZE)) {
+    return File();
+  }
+  
+  File file = dir.openNextFile();
+  while (file && file.isDirectory()) {
+    file.close();
+    file = dir.openNextFile();
+  }
+  if (file) {
+    // openNextFile leaves the directory positioned right behind the entry
+    entry = dir.position() / DIR_ENTRY_SIZE - 1;
+  }
+  return file;
+}
+
+bool AssetIndex :: loadIndex() {
+  char name[MAX_PATH_LENGTH];
+  strncpy_P(name, INDEX_FILENAME, MAX_PATH_LENGTH - 1);
+  name[MAX_PATH_LENGTH - 1] = '\0';
+  
+  File file = SD.open(name);
+  if (!file) {
+    return false;
+  }
+  
+  uint8_t header[3];
+  bool valid = (file.read(header, sizeof(header)) == sizeof(header)) 
+    && (header[0] == 'A') && (header[1] == 'I') && (header[2] == INDEX_VERSION);
+  
+  for (int dir = 0; valid && (dir < DIRECTORY_COUNT); dir++) {
+    uint8_t values[4]; // checksum, count
+    if (file.read(values, sizeof(values)) != sizeof(values)) {
+      valid = false;
+      break;
+    }
+    checksums[dir] = values[0] | (static_cast<uint16_t>(values[1]) << 8);
+    counts[dir] = values[2] | (static_cast<uint16_t>(values[3]) << 8);
+    if (totalCount() > MAX_FILES) {
+      valid = false;
+      break;
+    }
+    
+    const int bytes = counts[dir] * sizeof(uint16_t);
+    valid = file.read(directoryEntries(dir), bytes) == bytes;
+  }
+  
+  if (!valid) {
+    for (int dir = 0; dir < DIRECTORY_COUNT; dir++) {
+      counts[dir] = 0;
+    }
+  }
+  
+  file.close();
+  return valid;
+}
+
+bool AssetIndex :: validateDirectory(uint8_t dir) {
+  return directoryChecksum(dir) == checksums[dir];
+}
+
+bool AssetIndex :: scanStep() {
+  if (!scanDir) {
+    counts[currentDirectory] = 0;
+    checksums[currentDirectory] = directoryChecksum(currentDirectory);
+    scanDir = openDirectory(currentDirectory);
+    if (!scanDir) {
+      currentDirectory++;
+      return currentDirectory >= DIRECTORY_COUNT;
+    }
+  }
+  
+  for (int i = 0; i < ENTRIES_PER_STEP; i++) {
+    File file = scanDir.openNextFile();
+    if (!file) {
+      scanDir.close();
+      currentDirectory++;
+      return currentDirectory >= DIRECTORY_COUNT;
+    }
+    
+    if (!file.isDirectory()) {
+      if (totalCount() < MAX_FILES) {
+        directoryEntries(currentDirectory)[counts[currentDirectory]] = scanDir.position() / DIR_ENTRY_SIZE - 1;
+        counts[currentDirectory]++;
+      } else if (!indexFull) {
+        indexFull = true;
+        LOG_WARNING(MSG_INDEX_FULL).arg(MAX_FILES).arg(currentDirectory);
+      }
+    }
+    file.close();
+  }
+  return false;
+}
+
+void AssetIndex :: writeIndex() {
+  char name[MAX_PATH_LENGTH];
+  strncpy_P(name, INDEX_FILENAME, MAX_PATH_LENGTH - 1);
+  name[MAX_PATH_LENGTH - 1] = '\0';
+  
+  SD.remove(name); // FILE_WRITE appends, so start from scratch
+  File file = SD.open(name, FILE_WRITE);
+  if (!file) {
+    LOG_ERROR(MSG_INDEX_WRITE_FAILED);
+    return;
+  }
+  
+  const uint8_t header[3] = {'A', 'I', INDEX_VERSION};
+  file.write(header, sizeof(header));
+  for (int dir = 0; dir < DIRECTORY_COUNT; dir++) {
+    const uint8_t values[4] = {
+      static_cast<uint8_t>(checksums[dir]), static_cast<uint8_t>(checksums[dir] >> 8),
+      static_cast<uint8_t>(counts[dir]), static_cast<uint8_t>(counts[dir] >> 8)
+    };
+    file.write(values, sizeof(values));
+    file.write(reinterpret_cast<const uint8_t*>(directoryEntries(dir)), counts[dir] * sizeof(uint16_t));
+  }
+  file.close();
+}
+
+void AssetIndex :: invalidate() {
+  scanDir.close();
+  for (int dir = 0; dir < DIRECTORY_COUNT; dir++) {
+    counts[dir] = 0;
+    checksums[dir] = 0;
+  }
+  indexFull = false;
+  currentDirectory = 0;
+  state = SCAN;
+}
+
+bool AssetIndex :: update() {
+  switch (state) {
+    case INIT_CARD:
+      if (!SD.begin(sdPin)) {
+        LOG_ERROR(MSG_SD_INIT_FAILED);
+      }
+      state = LOAD_INDEX;
+      break;
+    case LOAD_INDEX:
+      if (loadIndex()) {
+        currentDirectory = 0;
+        state = VALIDATE;
+      } else {
+        invalidate();
+      }
+      break;
+    case VALIDATE:
+      if (!validateDirectory(currentDirectory)) {
+        LOG_INFO(MSG_INDEX_OUTDATED);
+        invalidate();
+      } else {
+        currentDirectory++;
+        if (currentDirectory >= DIRECTORY_COUNT) {
+          state = READY;
+        }
+      }
+      break;
+    case SCAN:
+      if (scanStep()) {
+        state = WRITE_INDEX;
+      }
+      break;
+    case WRITE_INDEX:
+      writeIndex();
+      state = READY;
+      break;
+    case READY:
+      break;
+  }
+  return state == READY;
+}
+
+void AssetIndex :: complete() {
+  while (!update()) {}
+}
+
+bool AssetIndex :: isReady() const {
+  return state == READY;
+}
+
+int AssetIndex :: count(Directory dir) const {
+  return counts[dir];
+}
+
+File AssetIndex :: open(Directory dir, int n) {
+  complete();
+  
+  // Second attempt only happens after the index turned out to be outdated
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if ((n < 0) || (n >= counts[dir])) {
+      return File();
+    }
+    
+    File d = openDirectory(dir);
+    const uint16_t knownEntry = directoryEntries(dir)[n];
+    uint16_t entry = knownEntry;
+    File file = openFileAt(d, entry);
+    d.close();
+    
+    if (file && (entry == knownEntry)) {
+      return file;
+    }
+    file.close();
+    
+    LOG_INFO(MSG_INDEX_OUTDATED);
+    invalidate();
+    complete();
+  }
+  return File();
+}
+
+bool AssetIndex :: getPath(Directory dir, int n, char* buffer, size_t size) {
+  File file = open(dir, n);
+  if (!file) {
+    return false;
+  }
+  
+  const char* dirName = reinterpret_cast<const char*>(pgm_read_word(DIRECTORY_NAMES + dir));
+  const size_t dirLength = strlen_P(dirName);
+  const size_t nameLength = strlen(file.name());
+  
+  bool result = false;
+  if (dirLength + 1 + nameLength < size) {
+    strcpy_P(buffer, dirName);
+    buffer[dirLength] = '/';
+    strcpy(buffer + dirLength + 1, file.name());
+    result = true;
+  }
+  
+  file.close();
+  return result;
+}
+
+AssetIndex :: AssetIndex(uint8_t sdPin) : sdPin(sdPin), state(INIT_CARD), currentDirectory(0), indexFull(false) {
+  for (int dir = 0; dir < DIRECTORY_COUNT; dir++) {
+    counts[dir] = 0;
+    checksums[dir] = 0;
+  }
+}
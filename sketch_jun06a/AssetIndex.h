@@ -0,0 +1,111 @@
+
+#ifndef ASSETINDEX_H_
+#define ASSETINDEX_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+#include <SD.h>
+
+// Keeps track of the asset files (images, texts, music, posters) on the SD card.
+//
+// Opening the Nth file of a directory with the SD library means opening 
+// all files in front of it. Instead, the index stores the directory entry
+// number of every file, so the directory can be seeked to the entry and 
+// only that file is opened (the SD library still walks the directory to 
+// look it up by name).
+//
+// The index is persisted on the card (INDEX_FILENAME) and loaded at boot.
+// The SD library does not expose directory modification times, so the
+// index stores a checksum of the raw entries of every directory instead. 
+// Any change to a directory (FAT also reuses the entries of deleted files) 
+// changes the checksum, which is compared at boot. An entry that no longer 
+// holds a file invalidates the index when it is reopened. In both cases 
+// the directories are rescanned.
+//
+// All work (including SD.begin) is done in small steps by update(), which
+// should be called from loop() so that nothing blocks the boot.
+//
+// The entries of all directories share one static table of MAX_FILES 
+// entries (2 bytes of SRAM each, 512 bytes in total). Files beyond that are
+// ignored and reported in the log. Raising the limit costs SRAM that heap
+// and stack may need: check the "never used" figure of the MemoryMonitor
+// report before doing so.
+class AssetIndex {
+  public:
+    enum Directory {
+      IMAGES, TEXTS, MUSIC, POSTERS, DIRECTORY_COUNT
+    };
+    
+    // Total number of files in all directories
+    const PROGMEM static unsigned int MAX_FILES = 256;
+    
+    // Large enough for "/<directory>/<8.3 filename>"
+    const PROGMEM static size_t MAX_PATH_LENGTH = 32;
+  private:
+    const PROGMEM static uint8_t INDEX_VERSION = 4;
+    const PROGMEM static uint8_t ENTRIES_PER_STEP = 4;
+    const PROGMEM static uint32_t DIR_ENTRY_SIZE = 32;
+    
+    static const char INDEX_FILENAME[] PROGMEM;
+    static const char* const DIRECTORY_NAMES[DIRECTORY_COUNT] PROGMEM;
+    
+    enum State {
+      INIT_CARD, LOAD_INDEX, VALIDATE, SCAN, WRITE_INDEX, READY
+    };
+    
+    uint8_t sdPin;
+    
+    State state;
+    uint8_t currentDirectory;
+    File scanDir;
+    
+    bool indexFull;
+    
+    // The entries of each directory follow those of the previous one
+    uint16_t counts[DIRECTORY_COUNT];
+    uint16_t checksums[DIRECTORY_COUNT];
+    uint16_t entries[MAX_FILES];
+    
+    uint16_t* directoryEntries(uint8_t dir);
+    unsigned int totalCount() const;
+    
+    File openDirectory(uint8_t dir);
+    
+    // Fletcher-16 checksum of the raw entries of dir, 0 if it does not exist.
+    // Reads the directory like a file, so no file is opened.
+    uint16_t directoryChecksum(uint8_t dir);
+    
+    // Opens the first file (not directory) at or behind the given entry of dir.
+    // Returns the entry number of the file in entry.
+    File openFileAt(File& dir, uint16_t& entry);
+    
+    bool loadIndex();
+    bool validateDirectory(uint8_t dir);
+    bool scanStep();
+    void writeIndex();
+    
+    void invalidate();
+  public:
+    // Performs one step of the asset discovery. Returns true if the index is ready.
+    bool update();
+    
+    // Blocks until the index is ready
+    void complete();
+    
+    bool isReady() const;
+    
+    int count(Directory dir) const;
+    
+    // Opens the nth file of the directory. Returns a closed file on failure.
+    File open(Directory dir, int n);
+    
+    // Writes the full path of the nth file of the directory into buffer,
+    // which should hold MAX_PATH_LENGTH characters. Returns false on failure.
+    bool getPath(Directory dir, int n, char* buffer, size_t size);
+    
+    AssetIndex(uint8_t sdPin);
+};
+
+#endif // ASSETINDEX_H_
@@ -0,0 +1,39 @@
+
+#ifndef BUILDCONFIG_H_
+#define BUILDCONFIG_H_
+
+// Build options of the sketch. The Arduino IDE cannot pass defines to the
+// compiler, so change the values here.
+
+// 1 = all subsystems live in static storage and the sketch itself does not
+//     use the heap, except for the tile cache of an open poster (the SD 
+//     library also allocates one fixed-size block per open file). These
+//     blocks are freed again on close.
+// 0 = subsystems are allocated with new in setup().
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 1
+#endif
+
+// Log statements above this level are compiled out (see Log.h):
+// LOG_LEVEL_NONE, LOG_LEVEL_ERROR, LOG_LEVEL_WARNING, LOG_LEVEL_INFO, LOG_LEVEL_DEBUG
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Interval (ms) of the stack/heap usage report in the log, 0 disables it
+#ifndef MEMORY_REPORT_INTERVAL
+#define MEMORY_REPORT_INTERVAL 60000UL
+#endif
+
+// 1 = sleep (idle mode) in loop() while there is nothing to do, waking up
+//     on the next timer tick to poll the keys and check for due work
+#ifndef IDLE_SLEEP
+#define IDLE_SLEEP 1
+#endif
+
+// Interval (ms) of the idle time and key latency report in the log, 0 disables it
+#ifndef IDLE_REPORT_INTERVAL
+#define IDLE_REPORT_INTERVAL 60000UL
+#endif
+
+#endif // BUILDCONFIG_H_
@@ -0,0 +1,88 @@
+
+#include "IdleSleep.h"
+
+#include <avr/sleep.h>
+
+#include "BuildConfig.h"
+#include "Log.h"
+
+unsigned long IdleSleep::sleptMicros = 0;
+unsigned long IdleSleep::periodStart = 0;
+unsigned long IdleSleep::lastPoll = 0;
+unsigned long IdleSleep::maxPollInterval = 0;
+bool IdleSleep::keyDown = false;
+bool IdleSleep::keyPending = false;
+bool IdleSleep::awaitingDisplay = false;
+unsigned long IdleSleep::keyPressTime = 0;
+uint16_t IdleSleep::displayFence = 0;
+unsigned long IdleSleep::maxKeyLatency = 0;
+
+void IdleSleep :: pollKeys(Numpad* numpad) {
+  const unsigned long now = micros();
+  if ((lastPoll != 0) && (now - lastPoll > maxPollInterval)) {
+    maxPollInterval = now - lastPoll;
+  }
+  lastPoll = now;
+  
+  const bool pressed = numpad->anyPressed();
+  if (pressed && !keyDown && !keyPending && !awaitingDisplay) {
+    // Presses during a running measurement are not measured
+    keyPending = true;
+    keyPressTime = now;
+  }
+  keyDown = pressed;
+}
+
+void IdleSleep :: sleepUntil(unsigned long deadline, Numpad* numpad) {
+  const unsigned long start = micros();
+  
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (isBefore(millis(), deadline)) {
+    pollKeys(numpad);
+    if (keyDown) {
+      break;
+    }
+    
+    // Any interrupt wakes the CPU up, the latest the next timer tick
+    noInterrupts();
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+    
+    Log::drain();
+  }
+  
+  sleptMicros += micros() - start;
+}
+
+void IdleSleep :: programRan(LCDDisplay* display) {
+  if (keyPending) {
+    keyPending = false;
+    awaitingDisplay = true;
+    displayFence = display->fence();
+  }
+}
+
+void IdleSleep :: update(LCDDisplay* display) {
+  if (awaitingDisplay && display->isFenceReached(displayFence)) {
+    awaitingDisplay = false;
+    const unsigned long latency = micros() - keyPressTime;
+    if (latency > maxKeyLatency) {
+      maxKeyLatency = latency;
+    }
+  }
+  
+#if IDLE_REPORT_INTERVAL > 0
+  const unsigned long elapsed = millis() - periodStart;
+  if (elapsed >= IDLE_REPORT_INTERVAL) {
+    const unsigned int idlePercent = sleptMicros / (elapsed * 10);
+    LOG_INFO(MSG_IDLE_STATS).arg(idlePercent).arg(elapsed / 1000).arg(maxKeyLatency).arg(maxPollInterval);
+    
+    periodStart = millis();
+    sleptMicros = 0;
+    maxKeyLatency = 0;
+    maxPollInterval = 0;
+  }
+#endif
+}
@@ -0,0 +1,60 @@
+
+#ifndef IDLESLEEP_H_
+#define IDLESLEEP_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+#include "LCD.h"
+#include "Numpad.h"
+
+// Lets the CPU sleep while loop() has nothing to do.
+//
+// Idle sleep mode keeps all timers running, so the millis() timer wakes the
+// CPU about every 1024 us. The key pins of the numpad have no pin change
+// interrupts on the Mega, so the keys are polled on every wakeup and on 
+// every loop() pass. The longest time between two polls bounds the time
+// from a key press to its detection, about one timer tick while idle.
+//
+// Also measures the idle time and the key latency: the time from the 
+// detection of a press until the display has executed everything the 
+// program queued in response to it.
+class IdleSleep {
+  private:
+    static unsigned long sleptMicros;
+    static unsigned long periodStart;
+    
+    static unsigned long lastPoll;
+    static unsigned long maxPollInterval;
+    
+    static bool keyDown;
+    static bool keyPending;       // Detected, the program has not run yet
+    static bool awaitingDisplay;  // The program ran, waiting for displayFence
+    static unsigned long keyPressTime;
+    static uint16_t displayFence;
+    static unsigned long maxKeyLatency;
+  public:
+    // Checks for a new key press, call at the start of loop()
+    static void pollKeys(Numpad* numpad);
+    
+    // Sleeps until the deadline (millis) has passed or a key is pressed.
+    // The log is drained on every wakeup.
+    static void sleepUntil(unsigned long deadline, Numpad* numpad);
+    
+    // Call after the current program has run: the display output for a 
+    // new key press is everything queued up to now
+    static void programRan(LCDDisplay* display);
+    
+    // Completes the latency measurement once the display has caught up and 
+    // logs the statistics every IDLE_REPORT_INTERVAL ms. Call from loop() 
+    // after processing the display queue and before sleeping.
+    static void update(LCDDisplay* display);
+};
+
+// Deadline helper that survives the overflow of millis()
+inline bool isBefore(unsigned long a, unsigned long b) {
+  return static_cast<long>(a - b) < 0;
+}
+
+#endif // IDLESLEEP_H_
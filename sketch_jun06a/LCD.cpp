@@ -98,11 +98,15 @@ void LCDDisplay :: writeToMemory(uint8_t b) {
 }
 
 bool LCDDisplay :: isDisplayOn() {
+  flush();
   updateState();
   return lastState.displayOn;
 }
 
 void LCDDisplay :: activateDisplay(bool activate) {
+  flush();
+  // The last queued command may have left only one half selected
+  activateChip(true, true);
   switchReadMode(WRITE);
   digitalWrite(COMMAND_MEM_SWITCH_PIN, LOW);
   
@@ -114,12 +118,14 @@ void LCDDisplay :: activateDisplay(bool activate) {
   issueCommand();
 }
 
-void LCDDisplay :: setVerticalScroll(int yoffset) {
+void LCDDisplay :: setVerticalScrollNow(int yoffset) {
   yoffset = yoffset % DISPLAY_HEIGHT;
   if (yoffset < 0) {
     yoffset += DISPLAY_HEIGHT;
   }
   
+  // Both halves have to scroll together
+  activateChip(true, true);
   digitalWrite(COMMAND_MEM_SWITCH_PIN, LOW);
   uint8_t DISPLAY_START_CMD = 0xC0;
   busWrite(DISPLAY_START_CMD | yoffset);
@@ -127,6 +133,7 @@ void LCDDisplay :: setVerticalScroll(int yoffset) {
 }
 
 void LCDDisplay :: testPattern() {
+  flush();
   switchReadMode(WRITE);
   
   for (int page = 0; page < 8; page++) {
@@ -156,10 +163,10 @@ void LCDDisplay :: testPattern() {
     delay(100);
   }
   
-  setVerticalScroll(0);
+  setVerticalScrollNow(0);
 }
 
-void LCDDisplay :: cls() {
+void LCDDisplay :: clsNow() {
   activateChip(true, true);
   for (int row = 0; row < ROW_COUNT; row++) {
     setICCursorPosition(row, 0);
@@ -169,7 +176,7 @@ void LCDDisplay :: cls() {
   }
 }
 
-void LCDDisplay :: writeRow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t* data) {
+void LCDDisplay :: writeRowNow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t* data) {
   if ((row >= ROW_COUNT) || (xoffset >= DISPLAY_WIDTH)) {
     return; // Nothing to do
   }
@@ -190,7 +197,7 @@ void LCDDisplay :: writeRow(unsigned int row, unsigned int xoffset, unsigned int
   }
 }
 
-void LCDDisplay :: fillRow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t value) {
+void LCDDisplay :: fillRowNow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t value) {
   if ((row >= ROW_COUNT) || (xoffset >= DISPLAY_WIDTH)) {
     return; // Nothing to do
   }
@@ -210,13 +217,237 @@ void LCDDisplay :: fillRow(unsigned int row, unsigned int xoffset, unsigned int
   }
 }
 
+void LCDDisplay :: setVerticalScroll(int yoffset) {
+  if (!asyncMode) {
+    setVerticalScrollNow(yoffset);
+    return;
+  }
+  
+  yoffset = yoffset % DISPLAY_HEIGHT;
+  if (yoffset < 0) {
+    yoffset += DISPLAY_HEIGHT;
+  }
+  
+  makeRoom(0);
+  enqueue(CMD_SCROLL).xoffset = yoffset;
+}
+
+void LCDDisplay :: cls() {
+  if (!asyncMode) {
+    clsNow();
+    return;
+  }
+  
+  makeRoom(0);
+  enqueue(CMD_CLS);
+}
+
+void LCDDisplay :: writeRow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t* data) {
+  if (!asyncMode) {
+    writeRowNow(row, xoffset, count, data);
+    return;
+  }
+  
+  if ((row >= ROW_COUNT) || (xoffset >= DISPLAY_WIDTH)) {
+    return; // Nothing to do
+  }
+  
+  if (xoffset + count > DISPLAY_WIDTH) {
+    count = DISPLAY_WIDTH - xoffset;
+  }
+  if (count == 0) {
+    return;
+  }
+  
+  makeRoom(count);
+  
+  QueuedCommand& cmd = enqueue(CMD_WRITE_ROW);
+  cmd.row = row;
+  cmd.xoffset = xoffset;
+  cmd.count = count;
+  cmd.dataIndex = dataHead;
+  
+  for (unsigned int i = 0; i < count; i++) {
+    dataBuffer[dataHead] = data[i];
+    dataHead = (dataHead + 1) & (DATA_BUFFER_SIZE - 1);
+  }
+  dataUsed += count;
+}
+
+void LCDDisplay :: fillRow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t value) {
+  if (!asyncMode) {
+    fillRowNow(row, xoffset, count, value);
+    return;
+  }
+  
+  if ((row >= ROW_COUNT) || (xoffset >= DISPLAY_WIDTH)) {
+    return; // Nothing to do
+  }
+  
+  if (xoffset + count > DISPLAY_WIDTH) {
+    count = DISPLAY_WIDTH - xoffset;
+  }
+  if (count == 0) {
+    return;
+  }
+  
+  makeRoom(0);
+  
+  QueuedCommand& cmd = enqueue(CMD_FILL_ROW);
+  cmd.row = row;
+  cmd.xoffset = xoffset;
+  cmd.count = count;
+  cmd.value = value;
+}
+
 void LCDDisplay :: writeImage(uint8_t* imgData) {
   for (int row = 0; row < ROW_COUNT; row++) {
     writeRow(row, 0, DISPLAY_WIDTH, imgData + row * DISPLAY_WIDTH);
   }
 }
 
-LCDDisplay :: LCDDisplay() {
+void LCDDisplay :: makeRoom(unsigned int bytes) {
+  while ((queueSize >= QUEUE_LENGTH) || (dataUsed + bytes > DATA_BUFFER_SIZE)) {
+    processQueue(BACKPRESSURE_SLICE_MICROS);
+    if (idleCallback) {
+      idleCallback();
+    }
+  }
+}
+
+LCDDisplay::QueuedCommand& LCDDisplay :: enqueue(uint8_t type) {
+  QueuedCommand& cmd = queue[(queueHead + queueSize) & (QUEUE_LENGTH - 1)];
+  cmd.type = type;
+  cmd.row = 0;
+  cmd.xoffset = 0;
+  cmd.count = 0;
+  cmd.value = 0;
+  cmd.dataIndex = 0;
+  cmd.progress = 0;
+  
+  queueSize++;
+  enqueuedCommands++;
+  return cmd;
+}
+
+bool LCDDisplay :: executeHead(unsigned long start, unsigned long budgetMicros) {
+  QueuedCommand& cmd = queue[queueHead];
+  
+  switch (cmd.type) {
+    case CMD_SCROLL:
+      setVerticalScrollNow(cmd.xoffset);
+      return true;
+    case CMD_CLS:
+      {
+        const uint16_t total = ROW_COUNT * IC_ROW_WIDTH;
+        bool resumed = true;
+        while (cmd.progress < total) {
+          const unsigned int row = cmd.progress / IC_ROW_WIDTH;
+          const unsigned int x = cmd.progress % IC_ROW_WIDTH;
+          if (resumed || (x == 0)) {
+            activateChip(true, true);
+            setICCursorPosition(row, x);
+            resumed = false;
+          }
+          writeToMemory(0);
+          cmd.progress++;
+          
+          if (micros() - start >= budgetMicros) {
+            break;
+          }
+        }
+        return cmd.progress >= total;
+      }
+    case CMD_WRITE_ROW:
+    case CMD_FILL_ROW:
+      {
+        bool resumed = true;
+        while (cmd.progress < cmd.count) {
+          const unsigned int x = cmd.xoffset + cmd.progress;
+          if (resumed || (x == IC_ROW_WIDTH)) {
+            // Must (re-)select the cursor and possibly the second chip
+            setCursorPosition(cmd.row, x);
+            resumed = false;
+          }
+          
+          if (cmd.type == CMD_WRITE_ROW) {
+            writeToMemory(dataBuffer[(cmd.dataIndex + cmd.progress) & (DATA_BUFFER_SIZE - 1)]);
+          } else {
+            writeToMemory(cmd.value);
+          }
+          cmd.progress++;
+          
+          if (micros() - start >= budgetMicros) {
+            break;
+          }
+        }
+        return cmd.progress >= cmd.count;
+      }
+  }
+  return true; // Unknown command, drop it
+}
+
+void LCDDisplay :: setAsyncMode(bool async) {
+  if (!async) {
+    flush();
+  }
+  asyncMode = async;
+}
+
+void LCDDisplay :: setIdleCallback(void (*callback)()) {
+  idleCallback = callback;
+}
+
+bool LCDDisplay :: processQueue(unsigned long budgetMicros) {
+  const unsigned long start = micros();
+  
+  while (queueSize > 0) {
+    if (!executeHead(start, budgetMicros)) {
+      return false; // Out of time
+    }
+    
+    QueuedCommand& cmd = queue[queueHead];
+    if (cmd.type == CMD_WRITE_ROW) {
+      dataUsed -= cmd.count;
+    }
+    queueHead = (queueHead + 1) & (QUEUE_LENGTH - 1);
+    queueSize--;
+    completedCommands++;
+    
+    if (micros() - start >= budgetMicros) {
+      break;
+    }
+  }
+  return queueSize == 0;
+}
+
+bool LCDDisplay :: isQueueEmpty() const {
+  return queueSize == 0;
+}
+
+uint16_t LCDDisplay :: fence() const {
+  return enqueuedCommands;
+}
+
+bool LCDDisplay :: isFenceReached(uint16_t fence) const {
+  // Difference taken as signed value to survive wrap-around of the counters
+  return static_cast<int16_t>(completedCommands - fence) >= 0;
+}
+
+void LCDDisplay :: waitForFence(uint16_t fence) {
+  while (!isFenceReached(fence)) {
+    processQueue(BACKPRESSURE_SLICE_MICROS);
+    if (idleCallback) {
+      idleCallback();
+    }
+  }
+}
+
+void LCDDisplay :: flush() {
+  waitForFence(fence());
+}
+
+LCDDisplay :: LCDDisplay() : asyncMode(false), queueHead(0), queueSize(0), dataHead(0), dataUsed(0), enqueuedCommands(0), completedCommands(0), idleCallback(NULL) {
   pinMode(RESET_PIN, OUTPUT);
   pinMode(CHIP1_SELECT_PIN, OUTPUT);
   pinMode(CHIP2_SELECT_PIN, OUTPUT);
@@ -27,6 +27,14 @@ class LCDDisplay {
     const PROGMEM static int BUS_START_PIN = 28;
     const PROGMEM static int BUS_END_PIN = 35;
 
+    // Sizes of the asynchronous command queue. Both must be powers of two.
+    // The data buffer holds the payload of queued writeRow commands.
+    const PROGMEM static unsigned int QUEUE_LENGTH = 16;
+    const PROGMEM static unsigned int DATA_BUFFER_SIZE = 256;
+    
+    // Slice length used while the queue is drained because it ran full
+    const PROGMEM static unsigned long BACKPRESSURE_SLICE_MICROS = 2000;
+
     struct State {
       bool displayOn;
       bool resetting;
@@ -41,6 +49,35 @@ class LCDDisplay {
     
     State lastState;
     
+    enum CommandType {
+      CMD_WRITE_ROW, CMD_FILL_ROW, CMD_SCROLL, CMD_CLS
+    };
+    
+    // A queued display operation. Commands are executed byte by byte, so
+    // a long command can be spread across several calls to processQueue().
+    struct QueuedCommand {
+      uint8_t type;
+      uint8_t row;
+      uint8_t xoffset;     // Scroll offset for CMD_SCROLL
+      uint8_t count;
+      uint8_t value;       // Fill value for CMD_FILL_ROW
+      uint16_t dataIndex;  // Start of the payload in dataBuffer for CMD_WRITE_ROW
+      uint16_t progress;   // Number of bytes already sent to the display
+    };
+    
+    bool asyncMode;
+    
+    QueuedCommand queue[QUEUE_LENGTH];
+    uint8_t queueHead, queueSize;
+    
+    uint8_t dataBuffer[DATA_BUFFER_SIZE];
+    uint16_t dataHead, dataUsed;
+    
+    // Number of commands ever enqueued/completed - used for fences
+    uint16_t enqueuedCommands, completedCommands;
+    
+    void (*idleCallback)();
+    
     void switchReadMode(ReadWriteMode mode);
 
     void issueCommand();
@@ -62,6 +99,23 @@ class LCDDisplay {
     
     // writes data into memory at the current memory position
     void writeToMemory(uint8_t b);
+    
+    // Synchronous implementations of the public drawing functions
+    void setVerticalScrollNow(int yoffset);
+    void clsNow();
+    void writeRowNow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t* data);
+    void fillRowNow(unsigned int row, unsigned int xoffset, unsigned int count, uint8_t value);
+    
+    // Drains the queue until the requested number of commands and payload
+    // bytes can be added to it
+    void makeRoom(unsigned int bytes);
+    
+    // Appends a command to the queue, the caller must have made room first
+    QueuedCommand& enqueue(uint8_t type);
+    
+    // Executes the head command until it is done or the deadline is reached.
+    // Returns true if the command completed.
+    bool executeHead(unsigned long start, unsigned long budgetMicros);
   public:
     bool isDisplayOn();
     
@@ -122,6 +176,37 @@ class LCDDisplay {
     //                are expected to follow one another in this repesentation.
     void writeImage(uint8_t* imgData);
     
+    // Asynchronous operation //
+    
+    // In async mode cls(), writeRow(), fillRow() and setVerticalScroll() only
+    // enqueue a command (copying the row data) and return. The queue is 
+    // drained by calling processQueue() regularly, e.g. once per loop().
+    // If the queue runs full, the caller blocks until there is room again;
+    // the idle callback is invoked between the drained slices so that 
+    // background work (music) keeps running. All other functions flush the 
+    // queue before touching the display.
+    void setAsyncMode(bool async);
+    
+    void setIdleCallback(void (*callback)());
+    
+    // Sends queued data to the display for at most (roughly) budgetMicros 
+    // microseconds. Returns true if the queue is empty afterwards.
+    bool processQueue(unsigned long budgetMicros);
+    
+    bool isQueueEmpty() const;
+    
+    // Returns a fence for all commands enqueued so far. The fence is reached
+    // as soon as all these commands have been sent to the display.
+    uint16_t fence() const;
+    
+    bool isFenceReached(uint16_t fence) const;
+    
+    // Drains the queue until the fence is reached
+    void waitForFence(uint16_t fence);
+    
+    // Drains the queue completely
+    void flush();
+    
     LCDDisplay();
 };
 
@@ -0,0 +1,111 @@
+
+#include "Log.h"
+
+uint8_t Log::buffer[Log::BUFFER_SIZE];
+uint8_t Log::head = 0;
+uint8_t Log::size = 0;
+unsigned int Log::dropped = 0;
+
+bool Log :: append(const uint8_t* record, uint8_t length) {
+  if (size + length > BUFFER_SIZE) {
+    return false;
+  }
+  
+  uint8_t tail = (head + size) & (BUFFER_SIZE - 1);
+  for (int i = 0; i < length; i++) {
+    buffer[tail] = record[i];
+    tail = (tail + 1) & (BUFFER_SIZE - 1);
+  }
+  size += length;
+  return true;
+}
+
+void Log :: commit(const uint8_t* record, uint8_t length) {
+  if (dropped > 0) {
+    // Report the loss first, so it shows up at the right place in the log
+    uint8_t droppedRecord[HEADER_LENGTH + sizeof(dropped)] = {SYNC_BYTE, MSG_DROPPED, sizeof(dropped)};
+    memcpy(droppedRecord + HEADER_LENGTH, &dropped, sizeof(dropped));
+    if (!append(droppedRecord, sizeof(droppedRecord))) {
+      dropped++;
+      return;
+    }
+    dropped = 0;
+  }
+  
+  if (!append(record, length)) {
+    dropped++;
+  }
+}
+
+void Log :: drain() {
+  int room = Serial.availableForWrite();
+  while ((room > 0) && (size > 0)) {
+    Serial.write(buffer[head]);
+    head = (head + 1) & (BUFFER_SIZE - 1);
+    size--;
+    room--;
+  }
+}
+
+bool Log :: isEmpty() {
+  return size == 0;
+}
+
+void LogRecord :: put(const void* value, uint8_t bytes) {
+  if (length + bytes > MAX_LENGTH) {
+    return; // Argument does not fit, the record will be cut short
+  }
+  memcpy(data + length, value, bytes);
+  length += bytes;
+}
+
+LogRecord& LogRecord :: arg(int value) {
+  put(&value, sizeof(value));
+  return *this;
+}
+
+LogRecord& LogRecord :: arg(unsigned int value) {
+  put(&value, sizeof(value));
+  return *this;
+}
+
+LogRecord& LogRecord :: arg(long value) {
+  put(&value, sizeof(value));
+  return *this;
+}
+
+LogRecord& LogRecord :: arg(unsigned long value) {
+  put(&value, sizeof(value));
+  return *this;
+}
+
+LogRecord& LogRecord :: arg(char value) {
+  put(&value, sizeof(value));
+  return *this;
+}
+
+LogRecord& LogRecord :: arg(const char* value) {
+  uint8_t stringLength = 0;
+  if (value) {
+    while ((stringLength < MAX_STRING_LENGTH) && value[stringLength]) {
+      stringLength++;
+    }
+  }
+  
+  if (length + 1 + stringLength <= MAX_LENGTH) {
+    data[length] = stringLength;
+    memcpy(data + length + 1, value, stringLength);
+    length += 1 + stringLength;
+  }
+  return *this;
+}
+
+LogRecord :: LogRecord(uint8_t id) : length(Log::HEADER_LENGTH) {
+  data[0] = Log::SYNC_BYTE;
+  data[1] = id;
+}
+
+LogRecord :: ~LogRecord() {
+  data[2] = length - Log::HEADER_LENGTH;
+  Log::commit(data, length);
+}
@@ -0,0 +1,85 @@
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+#include "BuildConfig.h"
+#include "LogMessages.h"
+
+// Non-blocking binary logging.
+//
+// A log statement only stores the message id and its binary arguments in a
+// ring buffer; Log::drain() moves the buffer to the UART as far as the 
+// UART's transmit buffer has room and never waits. Records that do not fit
+// into the ring buffer are dropped and counted. format-log.py turns the
+// byte stream back into text using the formats from LogMessages.h.
+//
+// Usage (arguments in the order of the format):
+//   LOG_INFO(MSG_SHOW_TEXT).arg(i).arg(filename);
+//
+// Statements above LOG_LEVEL are removed by the compiler. The parentheses
+// around LogRecord(id) keep a bare LOG_ERROR(id); from declaring a variable.
+//
+// Record layout: SYNC_BYTE, message id, payload length, payload
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4
+
+#define LOG_AT(level, id) if ((level) > LOG_LEVEL) {} else (LogRecord(id))
+
+#define LOG_ERROR(id)   LOG_AT(LOG_LEVEL_ERROR, id)
+#define LOG_WARNING(id) LOG_AT(LOG_LEVEL_WARNING, id)
+#define LOG_INFO(id)    LOG_AT(LOG_LEVEL_INFO, id)
+#define LOG_DEBUG(id)   LOG_AT(LOG_LEVEL_DEBUG, id)
+
+class Log {
+  public:
+    const PROGMEM static uint8_t SYNC_BYTE = 0xA5;
+    const PROGMEM static uint8_t HEADER_LENGTH = 3;
+  private:
+    // Must be a power of two
+    const PROGMEM static unsigned int BUFFER_SIZE = 128;
+    
+    static uint8_t buffer[BUFFER_SIZE];
+    static uint8_t head, size;
+    static unsigned int dropped;
+    
+    static bool append(const uint8_t* record, uint8_t length);
+  public:
+    // Adds a complete record to the ring buffer, or drops it if it does not fit
+    static void commit(const uint8_t* record, uint8_t length);
+    
+    // Sends as much of the buffer as the UART can take without blocking
+    static void drain();
+    
+    static bool isEmpty();
+};
+
+// A log record under construction, committed when it goes out of scope
+class LogRecord {
+  public:
+    const PROGMEM static uint8_t MAX_LENGTH = 32;
+    const PROGMEM static uint8_t MAX_STRING_LENGTH = 16;
+  private:
+    uint8_t data[MAX_LENGTH];
+    uint8_t length;
+    
+    void put(const void* value, uint8_t bytes);
+  public:
+    LogRecord& arg(int value);
+    LogRecord& arg(unsigned int value);
+    LogRecord& arg(long value);
+    LogRecord& arg(unsigned long value);
+    LogRecord& arg(char value);
+    LogRecord& arg(const char* value);
+    
+    LogRecord(uint8_t id);
+    ~LogRecord();
+};
+
+#endif // LOG_H_
@@ -0,0 +1,47 @@
+
+#ifndef LOGMESSAGES_H_
+#define LOGMESSAGES_H_
+
+// All messages the sketch can log: LOG_MESSAGE(id, format)
+//
+// The formats are never compiled into the sketch, only the position of a
+// message in this list is sent. format-log.py reads this file to turn the
+// binary log back into text, so only append new messages at the end and
+// keep one message per line. Supported conversions and argument types:
+//   %d, %u   -> int, unsigned int (2 bytes)
+//   %ld, %lu -> long, unsigned long (4 bytes)
+//   %c       -> char (1 byte)
+//   %s       -> const char* (truncated to LogRecord::MAX_STRING_LENGTH)
+#define LOG_MESSAGES \
+  LOG_MESSAGE(MSG_DROPPED, "%u log records dropped") \
+  LOG_MESSAGE(MSG_BOOT_TIME, "Time to menu (ms): %lu") \
+  LOG_MESSAGE(MSG_FIRST_SLIDE_TIME, "Time to first slide (ms): %lu") \
+  LOG_MESSAGE(MSG_IMAGE_NOT_FOUND, "Image file does not exist") \
+  LOG_MESSAGE(MSG_IMAGE_OPEN_FAILED, "Could not open file") \
+  LOG_MESSAGE(MSG_IMAGE_TRUNCATED, "Unexpected end of (image) file") \
+  LOG_MESSAGE(MSG_IMAGE_FAILED, "Display of image failed!") \
+  LOG_MESSAGE(MSG_SHOW_IMAGE, "Showing image number %d: %s") \
+  LOG_MESSAGE(MSG_SHOW_TEXT, "Showing text number %d: %s") \
+  LOG_MESSAGE(MSG_PLAY_MUSIC, "Playing music number %d: %s") \
+  LOG_MESSAGE(MSG_MUSIC_NOT_FOUND, "Music file not found") \
+  LOG_MESSAGE(MSG_MUSIC_OPEN_FAILED, "Cannot open music file") \
+  LOG_MESSAGE(MSG_SLIDE_TIMEOUT, "%lu  %lu") \
+  LOG_MESSAGE(MSG_MISSING_CHARACTER, "Trying to print character that is not represented in the charset. Char code: %d") \
+  LOG_MESSAGE(MSG_SD_INIT_FAILED, "SD card initialization failed") \
+  LOG_MESSAGE(MSG_INDEX_OUTDATED, "Asset index outdated, rescanning") \
+  LOG_MESSAGE(MSG_INDEX_WRITE_FAILED, "Could not write asset index") \
+  LOG_MESSAGE(MSG_MEMORY, "Memory at %lu s: heap peak %u B (after setup %u B), stack peak %u B, never used %u B") \
+  LOG_MESSAGE(MSG_SHOW_POSTER, "Showing poster number %d: %s") \
+  LOG_MESSAGE(MSG_POSTER_FAILED, "Display of poster failed!") \
+  LOG_MESSAGE(MSG_TEXT_TRUNCATED, "Unexpected end of (text) file") \
+  LOG_MESSAGE(MSG_IDLE_STATS, "Idle %u%% of the last %lu s, max key press to display latency %lu us, max key poll interval %lu us") \
+  LOG_MESSAGE(MSG_INDEX_FULL, "Asset index full (%u files), ignoring further files from directory %u on")
+
+enum LogMessageId {
+#define LOG_MESSAGE(id, format) id,
+  LOG_MESSAGES
+#undef LOG_MESSAGE
+  LOG_MESSAGE_COUNT
+};
+
+#endif // LOGMESSAGES_H_
@@ -0,0 +1,91 @@
+
+#include "MemoryMonitor.h"
+
+#include <avr/io.h>
+
+#include "BuildConfig.h"
+#include "Log.h"
+
+extern uint8_t __heap_start;
+
+size_t MemoryMonitor::setupHeapPeak = 0;
+unsigned long MemoryMonitor::lastReport = 0;
+
+// Runs from the .init3 section, after the stack pointer has been set up but 
+// before static data is initialized and any constructor runs. Must not use 
+// the stack, hence naked and assembler only.
+void paintStack() __attribute__ ((naked, used, section (".init3")));
+void paintStack() {
+  __asm volatile (
+    "    ldi r30, lo8(_end)\n"
+    "    ldi r31, hi8(_end)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "    rjmp 2f\n"
+    "1:\n"
+    "    st Z+, r24\n"
+    "2:\n"
+    "    cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    :
+    : "M" (MemoryMonitor::PAINT_VALUE)
+  );
+}
+
+MemoryMonitor::Usage MemoryMonitor :: measure() {
+  const uint8_t* stackPointer = reinterpret_cast<const uint8_t*>(SP);
+  
+  // Heap blocks and stack frames may hold bytes that happen to equal the
+  // paint, so the never used area is the longest run of paint between them
+  const uint8_t* unusedStart = stackPointer;
+  const uint8_t* unusedEnd = stackPointer;
+  const uint8_t* p = &__heap_start;
+  while (p < stackPointer) {
+    if (*p != PAINT_VALUE) {
+      p++;
+      continue;
+    }
+    
+    const uint8_t* runStart = p;
+    while ((p < stackPointer) && (*p == PAINT_VALUE)) {
+      p++;
+    }
+    if (p - runStart > unusedEnd - unusedStart) {
+      unusedStart = runStart;
+      unusedEnd = p;
+    }
+  }
+  
+  Usage usage;
+  usage.heapPeak = unusedStart - &__heap_start;
+  usage.neverUsed = unusedEnd - unusedStart;
+  usage.stackPeak = static_cast<size_t>(RAMEND) + 1 - reinterpret_cast<size_t>(unusedEnd);
+  return usage;
+}
+
+void MemoryMonitor :: markSetupDone() {
+  setupHeapPeak = measure().heapPeak;
+  lastReport = millis();
+  report();
+}
+
+void MemoryMonitor :: report() {
+  const Usage usage = measure();
+  
+  LOG_INFO(MSG_MEMORY)
+    .arg(millis() / 1000)
+    .arg(static_cast<unsigned int>(usage.heapPeak))
+    .arg(static_cast<unsigned int>(setupHeapPeak))
+    .arg(static_cast<unsigned int>(usage.stackPeak))
+    .arg(static_cast<unsigned int>(usage.neverUsed));
+}
+
+void MemoryMonitor :: update() {
+#if MEMORY_REPORT_INTERVAL > 0
+  if (millis() - lastReport >= MEMORY_REPORT_INTERVAL) {
+    lastReport = millis();
+    report();
+  }
+#endif
+}
@@ -0,0 +1,44 @@
+
+#ifndef MEMORYMONITOR_H_
+#define MEMORYMONITOR_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+// Reports SRAM usage high-water marks.
+//
+// Before main() runs, all memory between the end of the static data and the
+// top of the stack is painted with PAINT_VALUE. Heap and stack overwrite the
+// paint when they grow, so the painted area that is left tells how close
+// they ever came to each other:
+//
+//   __heap_start  [heap peak][ never used (painted) ][stack peak]  RAMEND
+//
+// The never used area is the longest run of paint, as heap and stack may 
+// contain single bytes that equal PAINT_VALUE.
+class MemoryMonitor {
+  public:
+    const PROGMEM static uint8_t PAINT_VALUE = 0xC5;
+    
+    struct Usage {
+      size_t heapPeak;     // bytes, highest extent of the heap
+      size_t stackPeak;    // bytes, deepest extent of the stack
+      size_t neverUsed;    // bytes, never touched by heap or stack
+    };
+  private:
+    static size_t setupHeapPeak;
+    static unsigned long lastReport;
+  public:
+    static Usage measure();
+    
+    // Records the heap usage after setup() as reference for later reports
+    static void markSetupDone();
+    
+    static void report();
+    
+    // Logs usage every MEMORY_REPORT_INTERVAL ms, call from loop()
+    static void update();
+};
+
+#endif // MEMORYMONITOR_H_
@@ -21,9 +21,20 @@ const char* Numpad :: getPressed() {
   return pressedKeys;
 }
 
+bool Numpad :: anyPressed() {
+  for (int i = 0; i < KEY_COUNT; i++) {
+    if ((*keyPorts[i] & keyMasks[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Numpad :: Numpad(uint8_t startpin) : startpin(startpin) {
-  for (int i = startpin; i < startpin + KEY_COUNT; i++) {
-    pinMode(i, INPUT_PULLUP);
+  for (int i = 0; i < KEY_COUNT; i++) {
+    pinMode(startpin + i, INPUT_PULLUP);
+    keyPorts[i] = portInputRegister(digitalPinToPort(startpin + i));
+    keyMasks[i] = digitalPinToBitMask(startpin + i);
   }
 }
 
@@ -10,10 +10,19 @@ class Numpad {
   private:
     uint8_t startpin;
     
+    // Input registers and bit masks of the key pins, for fast polling
+    volatile uint8_t* keyPorts[KEY_COUNT];
+    uint8_t keyMasks[KEY_COUNT];
+    
     char pressedKeys[12 + 1];
   public:
     bool isPressed(char c);
     
+    // Fast check for any pressed key (reads the port registers directly).
+    // Note that the pins 38 - 49 used on the Mega have no pin change 
+    // interrupts, so the keys can only be polled.
+    bool anyPressed();
+    
     const char* getPressed();
   
     Numpad(uint8_t startpin);
@@ -0,0 +1,114 @@
+
+#include "PanningViewer.h"
+
+int PanningViewer :: maxViewX() const {
+  const int result = static_cast<int>(image.getWidth()) - static_cast<int>(LCDDisplay::DISPLAY_WIDTH);
+  return result > 0 ? result : 0;
+}
+
+int PanningViewer :: maxViewY() const {
+  const int result = static_cast<int>(image.getHeight()) - static_cast<int>(LCDDisplay::DISPLAY_HEIGHT);
+  return result > 0 ? result : 0;
+}
+
+void PanningViewer :: drawPage(unsigned int ramPage) {
+  // Memory lines of this page hold image lines of page "upper" from the bit
+  // splitBit on, and lines of page "upper + ROW_COUNT" below it
+  const int firstLine = viewY - (viewY % LCDDisplay::DISPLAY_HEIGHT) + ramPage * 8;
+  int splitBit = viewY - firstLine;
+  if (splitBit < 0) {
+    splitBit = 0;
+  } else if (splitBit > 8) {
+    splitBit = 8;
+  }
+  const uint8_t upperMask = splitBit >= 8 ? 0 : static_cast<uint8_t>(0xFF << splitBit);
+  
+  const unsigned int upper = firstLine / 8;
+  const unsigned int lower = upper + LCDDisplay::ROW_COUNT;
+  
+  uint8_t row[LCDDisplay::DISPLAY_WIDTH];
+  
+  // Both pages lie in the window, so their tiles are cached side by side
+  unsigned int x = 0;
+  while (x < LCDDisplay::DISPLAY_WIDTH) {
+    const unsigned int imageX = viewX + x;
+    const unsigned int tx = imageX / TiledImage::TILE_WIDTH;
+    const unsigned int tileOffset = imageX % TiledImage::TILE_WIDTH;
+    unsigned int n = TiledImage::TILE_WIDTH - tileOffset;
+    if (n > LCDDisplay::DISPLAY_WIDTH - x) {
+      n = LCDDisplay::DISPLAY_WIDTH - x;
+    }
+    
+    const uint8_t* upperData = upperMask ? image.tile(upper, tx) : NULL;
+    const uint8_t* lowerData = upperMask != 0xFF ? image.tile(lower, tx) : NULL;
+    for (unsigned int i = 0; i < n; i++) {
+      const uint8_t upperValue = upperData ? upperData[tileOffset + i] & upperMask : 0;
+      const uint8_t lowerValue = lowerData ? lowerData[tileOffset + i] & ~upperMask : 0;
+      row[x + i] = upperValue | lowerValue;
+    }
+    x += n;
+  }
+  
+  display->writeRow(ramPage, 0, LCDDisplay::DISPLAY_WIDTH, row);
+}
+
+void PanningViewer :: redraw() {
+  display->setVerticalScroll(viewY % LCDDisplay::DISPLAY_HEIGHT);
+  for (unsigned int page = 0; page < LCDDisplay::ROW_COUNT; page++) {
+    drawPage(page);
+  }
+}
+
+bool PanningViewer :: show(File& file) {
+  if (!image.open(file)) {
+    return false;
+  }
+  
+  // Stored upside down: the top left corner is at the end of the image
+  viewX = maxViewX();
+  viewY = maxViewY();
+  redraw();
+  return true;
+}
+
+void PanningViewer :: close() {
+  image.close();
+  display->setVerticalScroll(0);
+}
+
+void PanningViewer :: pan(int dx, int dy) {
+  if (!image.isOpen()) {
+    return;
+  }
+  
+  // The display is mounted upside down
+  int newX = viewX - dx;
+  int newY = viewY - dy;
+  newX = newX < 0 ? 0 : (newX > maxViewX() ? maxViewX() : newX);
+  newY = newY < 0 ? 0 : (newY > maxViewY() ? maxViewY() : newY);
+  
+  if (newX != viewX) {
+    viewX = newX;
+    viewY = newY;
+    redraw();
+  } else if (newY != viewY) {
+    // Only the memory lines between the old and new position change
+    uint8_t dirtyPages = 0;
+    const int from = newY < viewY ? newY : viewY;
+    const int to = newY < viewY ? viewY : newY;
+    for (int y = from; (y < to) && (dirtyPages != 0xFF); y++) {
+      dirtyPages |= 1 << ((y % LCDDisplay::DISPLAY_HEIGHT) / 8);
+    }
+    
+    viewY = newY;
+    display->setVerticalScroll(viewY % LCDDisplay::DISPLAY_HEIGHT);
+    for (unsigned int page = 0; page < LCDDisplay::ROW_COUNT; page++) {
+      if (dirtyPages & (1 << page)) {
+        drawPage(page);
+      }
+    }
+  }
+}
+
+PanningViewer :: PanningViewer(LCDDisplay* display) : display(display), viewX(0), viewY(0) {
+}
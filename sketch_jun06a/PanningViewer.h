@@ -0,0 +1,50 @@
+
+#ifndef PANNINGVIEWER_H_
+#define PANNINGVIEWER_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+#include "LCD.h"
+#include "TiledImage.h"
+
+// Shows a 128x64 window of a TiledImage and moves it around.
+//
+// Vertical movement uses the scroll register of the display: the display
+// memory is used as a ring of 64 pixel lines, so that memory line r always
+// holds the image line y with y % 64 == r inside the window. When the window
+// moves, only the memory pages containing lines that changed are rewritten 
+// (a page can hold lines of two image pages, which are merged bitwise).
+// Horizontal movement has no hardware support and redraws the whole window.
+class PanningViewer {
+  private:
+    LCDDisplay* display;
+    TiledImage image;
+    
+    // Position of the window in the image, in display memory orientation
+    int viewX, viewY;
+    
+    int maxViewX() const;
+    int maxViewY() const;
+    
+    // Renders display memory page ramPage for the current window
+    void drawPage(unsigned int ramPage);
+    void redraw();
+  public:
+    // Takes over the file and shows the top left corner of the image.
+    // Returns false if the file is not a tiled image.
+    bool show(File& file);
+    
+    // Closes the image and resets the display scroll position
+    void close();
+    
+    // Moves the window by dx/dy pixels in the image as seen on the display
+    // (positive dx = right, positive dy = down). The window stops at the 
+    // edges of the image.
+    void pan(int dx, int dy);
+    
+    PanningViewer(LCDDisplay* display);
+};
+
+#endif // PANNINGVIEWER_H_
@@ -1,5 +1,7 @@
 #include "ReversedCharset.h"
 
+#include "Log.h"
+
 void ReversedCharset::displayString(int row, int offset, const char* text, bool clearBackground) {
   row = LCDDisplay::ROW_COUNT - 1 - row;
   offset = LCDDisplay::DISPLAY_WIDTH - 1 - offset;
@@ -7,8 +9,8 @@ void ReversedCharset::displayString(int row, int offset, const char* text, bool
   while (*text) {
     if (*text == ' ') {
       if (clearBackground) {
-        display->fillRow(row, offset - 3, 3, 0);
-        offset -= 3;
+        display->fillRow(row, offset - SPACE_WIDTH, SPACE_WIDTH, 0);
+        offset -= SPACE_WIDTH;
       }
     } else {
       int8_t address = pgm_read_byte(CHAR_LOOKUP_TABLE + *text);
@@ -27,14 +29,62 @@ void ReversedCharset::displayString(int row, int offset, const char* text, bool
         display->writeRow(row, offset - dataLen, dataLen, buffer);
         offset -= dataLen;
       } else {
-        Serial.print("Trying to print character that is not represented in the charset. Char code: ");
-        Serial.println(static_cast<int>(*text));
+        LOG_DEBUG(MSG_MISSING_CHARACTER).arg(static_cast<int>(*text));
       }
     }
     text++;
   }
 }
 
+bool ReversedCharset::displayShapedText(File& file) {
+  uint8_t header[4];
+  if ((file.read(header, sizeof(header)) != sizeof(header)) 
+      || (header[0] != 'S') || (header[1] != 'T') || (header[2] != SHAPED_TEXT_VERSION)) {
+    file.seek(0);
+    return false;
+  }
+  
+  // The records are read as they are stored: AVR is little endian and 
+  // does not pad the struct
+  ShapedGlyph glyphs[GLYPHS_PER_READ];
+  uint8_t line[LCDDisplay::DISPLAY_WIDTH];
+  uint8_t lines = header[3];
+  
+  // Empty rows are written too, which clears the rest of the screen
+  for (int row = 0; row < LCDDisplay::ROW_COUNT; row++) {
+    memset(line, 0, sizeof(line));
+    
+    int count = row < lines ? file.read() : 0;
+    if (count < 0) {
+      count = 0;
+      lines = row;
+      LOG_ERROR(MSG_TEXT_TRUNCATED);
+    }
+    
+    while (count > 0) {
+      const int n = count < GLYPHS_PER_READ ? count : GLYPHS_PER_READ;
+      const int bytes = n * sizeof(ShapedGlyph);
+      if (file.read(glyphs, bytes) != bytes) {
+        count = 0;
+        lines = row;
+        LOG_ERROR(MSG_TEXT_TRUNCATED);
+        break;
+      }
+      count -= n;
+      
+      for (int i = 0; i < n; i++) {
+        if (glyphs[i].x + glyphs[i].columns <= LCDDisplay::DISPLAY_WIDTH) {
+          memcpy_P(line + glyphs[i].x, CHARSET_DATA + glyphs[i].dataOffset, glyphs[i].columns);
+        }
+      }
+    }
+    
+    display->writeRow(LCDDisplay::ROW_COUNT - 1 - row, 0, LCDDisplay::DISPLAY_WIDTH, line);
+  }
+  
+  return true;
+}
+
 ReversedCharset :: ReversedCharset(LCDDisplay* display) : display(display) {
 }
 
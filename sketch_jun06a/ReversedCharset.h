@@ -5,10 +5,29 @@
 
 #include <stdint.h>
 
+#include <SD.h>
+
 #include "LCD.h"
 
+// Texts can also be pre-shaped by format-text.py (.STX files):
+//   'S', 'T', SHAPED_TEXT_VERSION, number of lines
+//   per line: number of glyphs, ShapedGlyph records
+// The records already hold the position and charset data of every glyph,
+// so displaying them only copies glyph columns from flash.
 class ReversedCharset {
+  public:
+    const PROGMEM static int SPACE_WIDTH = 3;
+    
+    const PROGMEM static uint8_t SHAPED_TEXT_VERSION = 2;
+    
+    struct ShapedGlyph {
+      uint8_t x;            // First column in the (rotated) display row
+      uint8_t columns;
+      uint16_t dataOffset;  // Into CHARSET_DATA
+    };
   private:
+    const PROGMEM static uint8_t GLYPHS_PER_READ = 16;
+    
     static const uint8_t CHARSET_DATA[] PROGMEM;
     static const uint16_t CHARACTER_OFFSETS[] PROGMEM;
     static const int8_t CHAR_LOOKUP_TABLE[] PROGMEM;
@@ -16,6 +35,11 @@ class ReversedCharset {
     LCDDisplay* display;
   public:
     void displayString(int row, int offset, const char* text, bool clearBackground);
+    
+    // Displays a text pre-shaped by format-text.py, clearing the rest of the
+    // screen. Returns false (and rewinds the file) if the file is not in 
+    // this format.
+    bool displayShapedText(File& file);
 
     ReversedCharset(LCDDisplay* display);
 };
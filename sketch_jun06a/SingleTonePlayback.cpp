@@ -1,5 +1,8 @@
 #include "SingleTonePlayback.h"
 
+#include "BuildConfig.h"
+#include "Log.h"
+
 
 BackgroundMusicPlayer* BackgroundMusicPlayer::singleton = NULL;
 
@@ -96,7 +99,7 @@ void BackgroundMusicPlayer :: playSingleToneMusic(const char* filename) {
       openFile = SD.open(localFilename);
     }
     if (!openFile) {
-      Serial.println("Cannot open music file");
+      LOG_ERROR(MSG_MUSIC_OPEN_FAILED);
     } else {
       lineReader = StreamLineReader(openFile);
       fillBuffer();      
@@ -109,8 +112,10 @@ void BackgroundMusicPlayer :: playSingleToneMusic(const char* filename) {
 }
 
 void BackgroundMusicPlayer :: playSingleToneMusic(const __FlashStringHelper* filename) {
-  String fn(filename);
-  playSingleToneMusic(fn.c_str());
+  char localFilename[64];
+  strncpy_P(localFilename, reinterpret_cast<const char*>(filename), 63);
+  localFilename[63] = '\0';
+  playSingleToneMusic(localFilename);
 }
 
 void BackgroundMusicPlayer :: stop() {
@@ -129,9 +134,22 @@ bool BackgroundMusicPlayer :: isPlaying() const {
   return playbackCursor < sampleCount; // only works in cooperative mode :-(
 }
 
+bool BackgroundMusicPlayer :: isActive() {
+  return isPlaying() || openFile;
+}
+
+unsigned long BackgroundMusicPlayer :: nextActionTime() const {
+  return nextAction;
+}
+
 BackgroundMusicPlayer* BackgroundMusicPlayer :: instance(int pin) {
   if (singleton == NULL) {
+#if STATIC_ALLOCATION
+    static BackgroundMusicPlayer staticInstance(pin);
+    singleton = &staticInstance;
+#else
     singleton = new BackgroundMusicPlayer(pin);
+#endif
   }
   return singleton;
 }
@@ -88,6 +88,12 @@ class BackgroundMusicPlayer {
     void stop();
     
     bool isPlaying() const;
+    
+    // True while a song is playing or more of it is to be read from the file
+    bool isActive();
+    
+    // Time (millis) at which the next note is due, only valid if isActive()
+    unsigned long nextActionTime() const;
   
     static BackgroundMusicPlayer* instance(int pin);
 };
@@ -0,0 +1,83 @@
+
+#include "TiledImage.h"
+
+bool TiledImage :: open(File& f) {
+  close();
+  file = f;
+  
+  uint8_t header[HEADER_LENGTH];
+  if (!file || (file.read(header, HEADER_LENGTH) != HEADER_LENGTH)
+      || (header[0] != 'P') || (header[1] != 'T') || (header[2] != FORMAT_VERSION)
+      || (header[3] != TILE_WIDTH)) {
+    close();
+    return false;
+  }
+  
+  width = header[4] | (static_cast<uint16_t>(header[5]) << 8);
+  pages = header[6];
+  tilesPerPage = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+  
+  if (static_cast<uint32_t>(tilesPerPage) * pages >= 0xFFFF) {
+    close(); // Tile numbers would not fit the cache tags
+    return false;
+  }
+  
+  cache = new Cache;
+  if (cache == NULL) {
+    close();
+    return false;
+  }
+  memset(cache->tags, 0, sizeof(cache->tags));
+  return true;
+}
+
+void TiledImage :: close() {
+  delete cache;
+  cache = NULL;
+  
+  file.close();
+  width = 0;
+  pages = 0;
+  tilesPerPage = 0;
+}
+
+bool TiledImage :: isOpen() {
+  return file;
+}
+
+unsigned int TiledImage :: getWidth() const {
+  return width;
+}
+
+unsigned int TiledImage :: getHeight() const {
+  return pages * 8;
+}
+
+unsigned int TiledImage :: getPages() const {
+  return pages;
+}
+
+const uint8_t* TiledImage :: tile(unsigned int page, unsigned int tx) {
+  if ((cache == NULL) || (page >= pages) || (tx >= tilesPerPage)) {
+    return NULL;
+  }
+  
+  const uint16_t tag = page * tilesPerPage + tx + 1;
+  uint16_t& slotTag = cache->tags[page % CACHE_PAGES][tx % CACHE_COLUMNS];
+  uint8_t* data = cache->data[page % CACHE_PAGES][tx % CACHE_COLUMNS];
+  if (slotTag == tag) {
+    return data;
+  }
+  
+  slotTag = 0;
+  const uint32_t offset = HEADER_LENGTH + static_cast<uint32_t>(tag - 1) * TILE_WIDTH;
+  if (!file.seek(offset) || (file.read(data, TILE_WIDTH) != TILE_WIDTH)) {
+    return NULL;
+  }
+  
+  slotTag = tag;
+  return data;
+}
+
+TiledImage :: TiledImage() : width(0), pages(0), tilesPerPage(0), cache(NULL) {
+}
@@ -0,0 +1,73 @@
+
+#ifndef TILEDIMAGE_H_
+#define TILEDIMAGE_H_
+
+#include <Arduino.h>
+
+#include <stdint.h>
+
+#include <SD.h>
+
+#include "LCD.h"
+
+// Read access to a large image on the SD card (created by format-poster.py).
+//
+// File layout:
+//   'P', 'T', version, TILE_WIDTH, width (uint16, little endian), pages, 0
+//   tiles, page by page, each page from left to right
+// A tile holds TILE_WIDTH column bytes of one page (8 pixel rows) in the
+// format of LCDDisplay::writeRow. Like all images, posters are stored 
+// rotated by 180 degrees, in the orientation of the display memory.
+//
+// The cache holds the tiles around a 128x64 window: a ring of CACHE_COLUMNS
+// tiles for each of CACHE_PAGES pages, indexed by tile column and page 
+// modulo the ring sizes. Tiles of the same window never share a slot, so 
+// moving the window only reads the tile column or page entering it.
+// At 1458 bytes it is too large to keep in SRAM for the whole runtime, so
+// like the block of the SD library for the open file, it is allocated on 
+// open() and freed on close(). Freed blocks of the same size are reused, 
+// so this does not fragment the heap.
+class TiledImage {
+  public:
+    const PROGMEM static unsigned int TILE_WIDTH = 16;
+  private:
+    const PROGMEM static uint8_t FORMAT_VERSION = 1;
+    const PROGMEM static uint8_t HEADER_LENGTH = 8;
+    
+    // A window that is not aligned to the tiles touches one more of them
+    const PROGMEM static unsigned int CACHE_COLUMNS = LCDDisplay::DISPLAY_WIDTH / TILE_WIDTH + 1;
+    const PROGMEM static unsigned int CACHE_PAGES = LCDDisplay::ROW_COUNT + 1;
+    
+    struct Cache {
+      // Tile number + 1 of every slot, 0 marks an empty slot
+      uint16_t tags[CACHE_PAGES][CACHE_COLUMNS];
+      uint8_t data[CACHE_PAGES][CACHE_COLUMNS][TILE_WIDTH];
+    };
+    
+    File file;
+    uint16_t width;
+    uint8_t pages;
+    uint16_t tilesPerPage;
+    
+    Cache* cache; // Only allocated while an image is open
+  public:
+    // Takes over the file, returns false if it is not a tiled image (or 
+    // there is no memory left for the cache)
+    bool open(File& f);
+    void close();
+    
+    bool isOpen();
+    
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    unsigned int getPages() const;
+    
+    // Returns the TILE_WIDTH column bytes of tile tx in the given page, or
+    // NULL if the tile is outside the image. The pointer stays valid while
+    // only tiles of the same 128x64 window are requested.
+    const uint8_t* tile(unsigned int page, unsigned int tx);
+    
+    TiledImage();
+};
+
+#endif // TILEDIMAGE_H_
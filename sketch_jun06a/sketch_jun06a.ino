@@ -10,18 +10,66 @@
 #include "SingleTonePlayback.h"
 #include "Numpad.h"
 #include "ReversedCharset.h"
+#include "AssetIndex.h"
+#include "PanningViewer.h"
+#include "MemoryMonitor.h"
+#include "IdleSleep.h"
+#include "BuildConfig.h"
+#include "Log.h"
 
 const PROGMEM int KEY_REPEAT_DURATION = 500; // ms - time within which no new key presses should be processed after initial stroke detection - repeat limiter and stroke noise removal
 
+const PROGMEM unsigned long SLIDE_DURATION = 60000; // ms per image or text
+const PROGMEM unsigned long MUSIC_PAUSE = 15000; // ms max between the start of last note of the last song and the start of the first note of the next song
+
+const PROGMEM unsigned long MAX_IDLE_MILLIS = 1000; // longest sleep of a program without timed work
+
+const PROGMEM int POSTER_PAN_STEP_X = 8; // pixels per frame while a pan key is held
+const PROGMEM int POSTER_PAN_STEP_Y = 2;
+
 const PROGMEM uint8_t DIGITAL_SOUND_PIN = 2;
 const PROGMEM uint8_t SPI_PIN = 4; // Required for sd card connection!!!
 const PROGMEM uint8_t NUMPAD_START_PIN = 38;
 
+const PROGMEM unsigned long DISPLAY_SLICE_MICROS = 2000; // Time per loop() iteration spent on sending queued data to the display
+
 // Global execution environment
 LCDDisplay* lcd_display;
 Numpad* numpad;
 ReversedCharset* rCharset;
 BackgroundMusicPlayer* musicPlayer;
+AssetIndex* assetIndex;
+PanningViewer* panningViewer;
+
+#if STATIC_ALLOCATION
+// Constructed before setup(), the constructors only configure pins
+LCDDisplay lcdDisplayStorage;
+ReversedCharset rCharsetStorage(&lcdDisplayStorage);
+Numpad numpadStorage(NUMPAD_START_PIN);
+AssetIndex assetIndexStorage(SPI_PIN);
+PanningViewer panningViewerStorage(&lcdDisplayStorage);
+#endif
+
+// Work that must continue while the caller blocks on a full display queue
+void displayIdleCallback() {
+  musicPlayer->updateBuffer();
+  Log::drain();
+}
+
+bool displayImage(File& file) {
+  uint8_t rowData[LCDDisplay::DISPLAY_WIDTH];
+
+  for (int row = 0; row < LCDDisplay::ROW_COUNT; row++) {
+    const int bytesRead = file.readBytes(rowData, LCDDisplay::DISPLAY_WIDTH);
+    if (bytesRead < LCDDisplay::DISPLAY_WIDTH) {
+      LOG_ERROR(MSG_IMAGE_TRUNCATED);
+      return false;
+    }
+    lcd_display->writeRow(row, 0, LCDDisplay::DISPLAY_WIDTH, rowData);
+  }
+  
+  return true;
+}
 
 bool displayImage(const char* filename) {
   // Arduino library designers do not know const correctness :-(
@@ -29,35 +77,27 @@ bool displayImage(const char* filename) {
   strncpy(localFilename, filename, 63);
 
   if (!SD.exists(localFilename)) {
-    Serial.println(F("Image file does not exist"));
+    LOG_ERROR(MSG_IMAGE_NOT_FOUND);
     return false;
   }
 
-  uint8_t rowData[LCDDisplay::DISPLAY_WIDTH];
-
   File file = SD.open(filename);
   if (!file) {
-    Serial.println(F("Could not open file"));
+    LOG_ERROR(MSG_IMAGE_OPEN_FAILED);
     return false;
-  } else {
-    for (int row = 0; row < LCDDisplay::ROW_COUNT; row++) {
-      const int bytesRead = file.readBytes(rowData, LCDDisplay::DISPLAY_WIDTH);
-      if (bytesRead < LCDDisplay::DISPLAY_WIDTH) {
-        Serial.println(F("Unexpected end of (image) file"));
-        file.close();
-        return false;
-      }
-      lcd_display->writeRow(row, 0, LCDDisplay::DISPLAY_WIDTH, rowData);
-    }
   }
+  
+  const bool result = displayImage(file);
   file.close();
   
-  return true;
+  return result;
 }
 
 bool displayImage(const __FlashStringHelper* str) {
-  String s(str);
-  return displayImage(s.c_str());
+  char filename[64];
+  strncpy_P(filename, reinterpret_cast<const char*>(str), 63);
+  filename[63] = '\0';
+  return displayImage(filename);
 }
 
 /////////////////////////// "PROGRAMS" //////////////////////////////
@@ -66,7 +106,14 @@ class Program {
   private:
   public:
     virtual void switchedTo() {}
+    virtual void switchedFrom() {}
     virtual Program* run() = 0;
+    
+    // Time (millis) until which loop() may sleep if no key is pressed. 
+    // Returning now disables sleeping.
+    virtual unsigned long wakeupDeadline(unsigned long now) {
+      return now;
+    }
 };
 
 class SlideShow : public Program {
@@ -75,83 +122,43 @@ class SlideShow : public Program {
     
     unsigned long lastImageOrTextTime, lastMusicEndTime;
     
-    int imageFiles;
-    int textFiles;
-    int musicFiles;
-    
     int lastImageOrText, currentImageOrText;
     
-    int countFiles(String dir) {
-      File d = SD.open(dir);
-      int result = 0;
-      
-      if (d) {
-        File file = d.openNextFile();
-        while (file) {
-          if (!file.isDirectory()) {
-            result++;
-          }
-          file.close();
-          file = d.openNextFile();
-        }
-        d.rewindDirectory();
-        d.close();
-      }
-      return result;
-    }
-    
-    String getNthFileName(String dir, int n) {
-      File d = SD.open(dir);
-      
-      if (d) {
-        File file = d.openNextFile();
-        while (file) {
-          String name = file.name();
-          bool isDir = file.isDirectory();
-          file.close();
-          
-          if (!isDir) {
-            if (n == 0) {
-              d.rewindDirectory();
-              d.close();
-              return dir + String(F("/")) + name;
-            }
-            
-            n--;
-          }
-          file = d.openNextFile();
-        }
-        d.rewindDirectory();
-        d.close();
-      }
-      return String();
-    }
+    // Time at which the slide show was entered and the display fence of the
+    // first slide, used to measure the time until the first slide is shown
+    unsigned long switchedToTime;
+    uint16_t firstSlideFence;
+    bool measuringFirstSlide;
     
     void playRandomMusic() {
-      int i = random(musicFiles);
-      String filename = getNthFileName(String(F("/music")), i);
+      int i = random(assetIndex->count(AssetIndex::MUSIC));
+      char filename[AssetIndex::MAX_PATH_LENGTH];
+      if (!assetIndex->getPath(AssetIndex::MUSIC, i, filename, sizeof(filename))) {
+        LOG_ERROR(MSG_MUSIC_NOT_FOUND);
+        lastMusicEndTime = millis(); // Try again after the next pause
+        return;
+      }
 
-      Serial.print(F("Playing music number "));
-      Serial.print(i);
-      Serial.print(F(": "));
-      Serial.println(filename);
+      LOG_INFO(MSG_PLAY_MUSIC).arg(i).arg(filename);
 
-      musicPlayer->playSingleToneMusic(filename.c_str());
+      musicPlayer->playSingleToneMusic(filename);
       lastMusicEndTime = millis();
     }
     
     void showText(int i) {
-      String filename = getNthFileName(String(F("/texts")), i);
-      Serial.print(F("Showing text number "));
-      Serial.print(i);
-      Serial.print(F(": "));
-      Serial.println(filename);
+      File file = assetIndex->open(AssetIndex::TEXTS, i);
+      LOG_INFO(MSG_SHOW_TEXT).arg(i).arg(file ? file.name() : "");
       
-      File file = SD.open(filename);
+      if (file && rCharset->displayShapedText(file)) {
+        file.close();
+        return;
+      }
+      
+      // Plain text file
       StreamLineReader lineReader(file); // This one comes from SingleTonePlayback.h - quite dirty, but I got no time :-(
       
       lcd_display->cls();
-      for (int row = 0; row < LCDDisplay::ROW_COUNT; row++) {
+      for (int row = 0; file && (row < LCDDisplay::ROW_COUNT); row++) {
         const char* line = lineReader.readLine();
         if (line == NULL) {
           break;
@@ -163,22 +170,21 @@ class SlideShow : public Program {
     }
     
     void showImage(int i) {
-      String filename = getNthFileName(String(F("/images")), i);
-      Serial.print(F("Showing image number "));
-      Serial.print(i);
-      Serial.print(F(": "));
-      Serial.println(filename);
+      File file = assetIndex->open(AssetIndex::IMAGES, i);
+      LOG_INFO(MSG_SHOW_IMAGE).arg(i).arg(file ? file.name() : "");
       
-      bool succeeded = displayImage(filename.c_str());
+      bool succeeded = file && displayImage(file);
       if (!succeeded) {
-        Serial.println("Display of image failed!");
+        LOG_ERROR(MSG_IMAGE_FAILED);
       }
+      file.close();
     }
     
     void showI(int i) {
       lastImageOrText = currentImageOrText;
       currentImageOrText = i;
       
+      const int imageFiles = assetIndex->count(AssetIndex::IMAGES);
       if (i >= imageFiles) {
         showText(i - imageFiles);
       } else {
@@ -189,34 +195,40 @@ class SlideShow : public Program {
     }
     
     void nextRandomImageOrText() {
+      const int slides = assetIndex->count(AssetIndex::IMAGES) + assetIndex->count(AssetIndex::TEXTS);
       int next = currentImageOrText;
-      while (next == currentImageOrText) {
-        next = random(imageFiles + textFiles);
+      while ((next == currentImageOrText) && (slides > 1)) {
+        next = random(slides);
       }
       showI(next);
     }
   public:
     virtual void switchedTo() {
+      switchedToTime = millis();
       randomSeed(millis());
       
       lastKeyPress = millis();
       lcd_display->cls();
       
-      Serial.println("Counting images");
-      imageFiles = countFiles(String(F("/images")));
-      Serial.println("Counting texts");
-      textFiles = countFiles(String(F("/texts")));
-      Serial.println("Counting music");
-      musicFiles = countFiles(String(F("/music")));
+      // Normally discovered in the background while the menu is shown
+      assetIndex->complete();
       
-      currentImageOrText = random(imageFiles + textFiles);
+      currentImageOrText = random(assetIndex->count(AssetIndex::IMAGES) + assetIndex->count(AssetIndex::TEXTS));
       lastImageOrText = currentImageOrText;
       showI(currentImageOrText);
       
+      firstSlideFence = lcd_display->fence();
+      measuringFirstSlide = true;
+      
       playRandomMusic();
     }
 
     virtual Program* run() {
+      if (measuringFirstSlide && lcd_display->isFenceReached(firstSlideFence)) {
+        measuringFirstSlide = false;
+        LOG_INFO(MSG_FIRST_SLIDE_TIME).arg(millis() - switchedToTime);
+      }
+      
       if (millis() - lastKeyPress > KEY_REPEAT_DURATION) {
         // New key presses are allowed now
         if (numpad->isPressed('6')) {
@@ -229,21 +241,31 @@ class SlideShow : public Program {
         }
       }
       
-      if (millis() - lastImageOrTextTime > 60000) { // 1 min per image or text
+      if (millis() - lastImageOrTextTime > SLIDE_DURATION) {
         nextRandomImageOrText();
-        Serial.print(millis());
-        Serial.print("  ");
-        Serial.println(lastImageOrTextTime);
+        LOG_DEBUG(MSG_SLIDE_TIMEOUT).arg(millis()).arg(lastImageOrTextTime);
       }
       
       if (musicPlayer->isPlaying()) {
         lastMusicEndTime = millis();
-      } else if (millis() - lastMusicEndTime > 15000) { // 15 sec max between the start of last note of the last song and the start of the first note of the next song
+      } else if (millis() - lastMusicEndTime > MUSIC_PAUSE) {
         playRandomMusic();
       }
       
       return this;
     }
+    
+    virtual unsigned long wakeupDeadline(unsigned long now) {
+      if (measuringFirstSlide) {
+        return now;
+      }
+      
+      unsigned long deadline = lastImageOrTextTime + SLIDE_DURATION + 1;
+      if (!musicPlayer->isActive() && isBefore(lastMusicEndTime + MUSIC_PAUSE + 1, deadline)) {
+        deadline = lastMusicEndTime + MUSIC_PAUSE + 1;
+      }
+      return deadline;
+    }
 };
 
 class SoundKeyboard : public Program {
@@ -290,13 +312,83 @@ class SoundKeyboard : public Program {
       
       return this;
     }
+    
+    virtual unsigned long wakeupDeadline(unsigned long now) {
+      return now + MAX_IDLE_MILLIS;
+    }
+};
+
+class PosterViewer : public Program {
+  private:
+    unsigned long lastKeyPress;
+    int currentPoster;
+    
+    void showPoster(int i) {
+      File file = assetIndex->open(AssetIndex::POSTERS, i);
+      LOG_INFO(MSG_SHOW_POSTER).arg(i).arg(file ? file.name() : "");
+      
+      lcd_display->cls();
+      if (!panningViewer->show(file)) { // The viewer took over the file
+        LOG_ERROR(MSG_POSTER_FAILED);
+        rCharset->displayString(0, 5, "No poster to show.", true);
+      }
+    }
+  public:
+    virtual void switchedTo() {
+      musicPlayer->stop();
+      
+      lastKeyPress = millis();
+      currentPoster = 0;
+      showPoster(currentPoster);
+    }
+    
+    virtual void switchedFrom() {
+      panningViewer->close();
+    }
+    
+    virtual Program* run() {
+      // Pan as fast as the display accepts the data, but do not pile up frames
+      if (lcd_display->isQueueEmpty()) {
+        int dx = 0, dy = 0;
+        if (numpad->isPressed('4')) {
+          dx -= POSTER_PAN_STEP_X;
+        }
+        if (numpad->isPressed('6')) {
+          dx += POSTER_PAN_STEP_X;
+        }
+        if (numpad->isPressed('2')) {
+          dy -= POSTER_PAN_STEP_Y;
+        }
+        if (numpad->isPressed('8')) {
+          dy += POSTER_PAN_STEP_Y;
+        }
+        
+        if ((dx != 0) || (dy != 0)) {
+          panningViewer->pan(dx, dy);
+        }
+      }
+      
+      if ((millis() - lastKeyPress > KEY_REPEAT_DURATION) && numpad->isPressed('5')) {
+        const int posters = assetIndex->count(AssetIndex::POSTERS);
+        currentPoster = posters > 0 ? (currentPoster + 1) % posters : 0;
+        showPoster(currentPoster);
+        lastKeyPress = millis();
+      }
+      
+      return this;
+    }
+    
+    virtual unsigned long wakeupDeadline(unsigned long now) {
+      return now + MAX_IDLE_MILLIS;
+    }
 };
 
 // Default fallback program
 class OS : public Program {
   private:
-    SlideShow* slideShow;
-    SoundKeyboard* keyboard;
+    SlideShow slideShow;
+    SoundKeyboard keyboard;
+    PosterViewer posterViewer;
   public:
     virtual void switchedTo() {
       musicPlayer->stop();
@@ -311,65 +403,115 @@ class OS : public Program {
       rCharset->displayString(3, 5, "at any time.", true);
       rCharset->displayString(5, 5, "(1) Slide show.", true);
       rCharset->displayString(6, 5, "(2) Keyboard.", true);
+      rCharset->displayString(7, 5, "(3) Poster viewer.", true);
     }
   
     virtual Program* run() {
       if (numpad->isPressed('1')) {
-        return slideShow;
+        return &slideShow;
       }
       if (numpad->isPressed('2')) {
-        return keyboard;
+        return &keyboard;
+      }
+      if (numpad->isPressed('3')) {
+        return &posterViewer;
       }
       
       return this;
     }
     
-    OS() {
-      slideShow = new SlideShow();
-      keyboard = new SoundKeyboard();
+    virtual unsigned long wakeupDeadline(unsigned long now) {
+      return now + MAX_IDLE_MILLIS;
     }
 };
 
 Program* currentProgram;
 OS* osProgram;
 
+#if STATIC_ALLOCATION
+OS osProgramStorage;
+#endif
+
 void setup() {
+#if STATIC_ALLOCATION
+  lcd_display = &lcdDisplayStorage;
+  rCharset = &rCharsetStorage;
+  numpad = &numpadStorage;
+#else
   lcd_display = new LCDDisplay;
-  lcd_display->cls();
-  lcd_display->activateDisplay(true);
 
   rCharset = new ReversedCharset(lcd_display);
   
   numpad = new Numpad(NUMPAD_START_PIN);
+#endif
 
   musicPlayer = BackgroundMusicPlayer::instance(DIGITAL_SOUND_PIN);
+  
+  // From here on drawing is queued and drained from loop()
+  lcd_display->setIdleCallback(&displayIdleCallback);
+  lcd_display->setAsyncMode(true);
 
-  // Debug output initialization
+  // Debug output initialization - see Log.h and format-log.py
   Serial.begin(9600);
 
-  // SD card initialization
-  SD.begin(SPI_PIN);
+  // SD card initialization and asset discovery happen in the background
+#if STATIC_ALLOCATION
+  assetIndex = &assetIndexStorage;
+  panningViewer = &panningViewerStorage;
+  osProgram = &osProgramStorage;
+#else
+  assetIndex = new AssetIndex(SPI_PIN);
+  panningViewer = new PanningViewer(lcd_display);
   
   osProgram = new OS();
+#endif
 
   currentProgram = osProgram;
   currentProgram->switchedTo();
+  
+  // Only switch on the display when the menu is in display memory,
+  // the power-on memory content is garbage
+  lcd_display->activateDisplay(true);
+  
+  LOG_INFO(MSG_BOOT_TIME).arg(millis());
+  
+  MemoryMonitor::markSetupDone();
 }
 
 void loop() {
+  IdleSleep::pollKeys(numpad);
+  
   // Cooperative multitasking - currentProgram
   Program* newProgram = currentProgram->run();
+  IdleSleep::programRan(lcd_display);
   if ((newProgram == NULL) || (numpad->isPressed('#'))) {
     newProgram = osProgram;
   }
   
   if (currentProgram != newProgram) {
+    currentProgram->switchedFrom();
     currentProgram = newProgram;
     currentProgram->switchedTo();
   }
   
   // Regular updates...
   BackgroundMusicPlayer::instance(DIGITAL_SOUND_PIN)->updateBuffer();
+  lcd_display->processQueue(DISPLAY_SLICE_MICROS);
+  assetIndex->update();
+  MemoryMonitor::update();
+  IdleSleep::update(lcd_display);
+  Log::drain();
+  
+#if IDLE_SLEEP
+  // Sleep until the next note, slide, etc. when all background work is done
+  if (lcd_display->isQueueEmpty() && assetIndex->isReady()) {
+    unsigned long deadline = currentProgram->wakeupDeadline(millis());
+    if (musicPlayer->isActive() && isBefore(musicPlayer->nextActionTime(), deadline)) {
+      deadline = musicPlayer->nextActionTime();
+    }
+    IdleSleep::sleepUntil(deadline, numpad);
+  }
+#endif
 }
 
 